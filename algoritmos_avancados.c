@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "mansao_tabelas.h"
+
 // Desafio Detective Quest
 // Tema 4 - Árvores e Tabela Hash
 // Este código inicial serve como base para o desenvolvimento das estruturas de navegação, pistas e suspeitos.
@@ -10,7 +12,8 @@
 // 🌱 Nível Novato: Mapa da Mansão com Árvore Binária
 
 // - Cria uma struct Sala com nome e ponteiros para a esquerda e direita.
-// - As funções criarSala(), conectarSalas() e explorarSalas() constroem e exploram o mapa.
+// - O mapa vem pronto de mansao_tabelas.h (gerado de mansao.txt por gerar_tabelas.c)
+//   e explorarSalas() o percorre.
 // - A navegação é feita por escolhas: esquerda (e), direita (d) ou sair (s).
 // - A estrutura é fixa, representando cômodos da mansão.
 // - Nenhuma inserção dinâmica de novas salas ocorre durante a execução.
@@ -19,35 +22,18 @@
 // Estrutura da sala (nó da árvore binária)
 typedef struct Sala {
     char nome[50];
-    struct Sala* esquerda;
-    struct Sala* direita;
+    const struct Sala* esquerda;
+    const struct Sala* direita;
 } Sala;
 
-// Função: criarSala()
-// Cria uma nova sala dinamicamente e retorna seu ponteiro.
-Sala* criarSala(const char* nome) {
-    Sala* nova = (Sala*) malloc(sizeof(Sala));
-    if (nova == NULL) {
-        printf("Erro ao alocar memória para a sala!\n");
-        exit(1);
-    }
-    strcpy(nova->nome, nome);
-    nova->esquerda = NULL;
-    nova->direita = NULL;
-    return nova;
-}
-
-// Função: conectarSalas()
-// Conecta uma sala principal a duas outras (esquerda e direita).
-void conectarSalas(Sala* principal, Sala* esquerda, Sala* direita) {
-    if (principal == NULL) return;
-    principal->esquerda = esquerda;
-    principal->direita = direita;
-}
+// Mapa da mansão: vetor constante montado na compilação, com os filhos
+// apontando para os próprios elementos (a sala 0 é o hall). Não há nada a
+// alocar nem a liberar, e o mapa fica em memória somente leitura.
+static const Sala mansao[MANSAO_TOTAL_SALAS] = { MANSAO_SALAS(mansao) };
 
 // Função: explorarSalas()
 // Permite que o jogador explore a mansão interativamente.
-void explorarSalas(Sala* atual) {
+void explorarSalas(const Sala* atual) {
     char opcao;
 
     while (atual != NULL) {
@@ -83,40 +69,15 @@ void explorarSalas(Sala* atual) {
     }
 }
 
-// Função: liberarArvore()
-// Libera a memória de todas as salas recursivamente.
-void liberarArvore(Sala* raiz) {
-    if (raiz == NULL) return;
-    liberarArvore(raiz->esquerda);
-    liberarArvore(raiz->direita);
-    free(raiz);
-}
-
 // Função: main()
-// Monta o mapa da mansão e inicia o jogo.
+// Inicia o jogo a partir do hall.
 int main() {
 
-    // Criação das salas principais
-    Sala* hall = criarSala("Hall de Entrada");
-    Sala* salaEstar = criarSala("Sala de Estar");
-    Sala* cozinha = criarSala("Cozinha");
-    Sala* biblioteca = criarSala("Biblioteca");
-    Sala* jardim = criarSala("Jardim de Inverno");
-    Sala* sotao = criarSala("Sótão");
-    Sala* quarto = criarSala("Quarto de Hóspedes");
-
-    // Conexões entre as salas (árvore binária)
-    conectarSalas(hall, salaEstar, cozinha);
-    conectarSalas(salaEstar, biblioteca, jardim);
-    conectarSalas(cozinha, sotao, quarto);
-
     // Início da exploração
     printf("=== Detective Quest: Exploração da Mansão ===\n");
-    explorarSalas(hall);
+    explorarSalas(&mansao[0]);
 
-    // Liberação da memória
-    liberarArvore(hall);
-    printf("\nMemória liberada. Até a próxima investigação!\n");
+    printf("\nAté a próxima investigação!\n");
 
     return 0;
 }
@@ -0,0 +1,705 @@
+// Desafio Detective Quest
+// Benchmark do Nível Mestre: gera entradas sintéticas grandes para o mapa,
+// a árvore de pistas e a tabela de suspeitos, e mede cada operação.
+//
+// Compilar: gcc -O2 -pthread benchmark_mestre.c -o benchmark_mestre
+// Uso:      ./benchmark_mestre [--salas N] [--pistas N] [--associacoes N] [--semente S]
+//
+// Saída: uma linha por teste, separada por tabulações, com cabeçalho fixo:
+//   teste  n  ns_por_op  rss_pico_kb  mallocs
+// 'mallocs' é o número de chamadas a malloc feitas durante o teste e
+// 'rss_pico_kb' é o pico de memória residente do processo até o fim do teste.
+// O formato é estável para comparar execuções com diff.
+
+#define NIVEL_MESTRE_SEM_MAIN
+#include "nivel_mestre.c"
+
+#include <sys/resource.h>
+
+// Gerador pseudoaleatório determinístico (xorshift64*)
+uint64_t estadoAleatorio = 88172645463325252ULL;
+
+uint64_t proximoAleatorio() {
+    estadoAleatorio ^= estadoAleatorio >> 12;
+    estadoAleatorio ^= estadoAleatorio << 25;
+    estadoAleatorio ^= estadoAleatorio >> 27;
+    return estadoAleatorio * 2685821657736338717ULL;
+}
+
+void embaralhar(uint32_t* v, size_t n) {
+    for (size_t i = n; i > 1; i--) {
+        size_t j = proximoAleatorio() % i;
+        uint32_t tmp = v[i - 1];
+        v[i - 1] = v[j];
+        v[j] = tmp;
+    }
+}
+
+long rssPicoKb() {
+    struct rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    return uso.ru_maxrss;
+}
+
+// Medição de um teste: chame iniciarMedicao antes e terminarMedicao depois
+double inicioMedicao;
+size_t mallocsInicio;
+
+void iniciarMedicao() {
+    mallocsInicio = totalMallocs;
+    inicioMedicao = agoraSegundos();
+}
+
+void terminarMedicao(const char* teste, size_t n) {
+    double tempo = agoraSegundos() - inicioMedicao;
+    printf("%s\t%zu\t%.1f\t%ld\t%zu\n", teste, n, n ? tempo * 1e9 / n : 0.0,
+           rssPicoKb(), (size_t) totalMallocs - mallocsInicio);
+    fflush(stdout);
+}
+
+// Redireciona stdout para /dev/null enquanto funções que imprimem são medidas
+int stdoutSalvo = -1;
+
+void silenciarSaida() {
+    fflush(stdout);
+    stdoutSalvo = dup(STDOUT_FILENO);
+    int nulo = open("/dev/null", O_WRONLY);
+    dup2(nulo, STDOUT_FILENO);
+    close(nulo);
+}
+
+void restaurarSaida() {
+    fflush(stdout);
+    dup2(stdoutSalvo, STDOUT_FILENO);
+    close(stdoutSalvo);
+}
+
+// Passeios da raiz até uma folha escolhendo e/d ao acaso; retorna salas visitadas
+size_t passearMapa(size_t passeios) {
+    size_t visitadas = 0;
+    for (size_t p = 0; p < passeios; p++) {
+        int s = 0;
+        while (s != SALA_NENHUMA) {
+            visitadas++;
+            s = proximoAleatorio() & 1 ? salas[s].esquerda : salas[s].direita;
+        }
+    }
+    return visitadas;
+}
+
+// Mapa: árvore binária completa com n salas, criada e conectada por nível,
+// e o mesmo mapa carregado de um arquivo gerado
+void benchMapa(size_t n) {
+    char nome[MAX_NOME];
+    iniciarMedicao();
+    for (size_t i = 0; i < n; i++) {
+        snprintf(nome, sizeof(nome), "Sala %zu", i);
+        criarSala(nome);
+    }
+    terminarMedicao("criarSala", n);
+
+    iniciarMedicao();
+    for (size_t i = 0; i < n; i++) {
+        int e = 2 * i + 1 < n ? (int) (2 * i + 1) : SALA_NENHUMA;
+        int d = 2 * i + 2 < n ? (int) (2 * i + 2) : SALA_NENHUMA;
+        conectarSalas((int) i, e, d);
+    }
+    terminarMedicao("conectarSalas", n);
+
+    // portas extras aleatórias: ciclos e salas com mais de um caminho
+    for (size_t i = 0; i < n / 2; i++)
+        adicionarPorta((int) (proximoAleatorio() % n), (int) (proximoAleatorio() % n));
+
+    iniciarMedicao();
+    ordenarSalasEmLargura(0);
+    terminarMedicao("ordenarSalasEmLargura", n);
+
+    size_t passeios = 100000;
+    iniciarMedicao();
+    size_t visitadas = passearMapa(passeios);
+    terminarMedicao("passearMapa", visitadas);
+
+    iniciarMedicao();
+    montarGrafoSalas();
+    terminarMedicao("montarGrafoSalas", n);
+
+    Sessao sessao;
+    iniciarSessao(&sessao, 0);
+    size_t buscas = 10, alcancadas = 0;
+    iniciarMedicao();
+    for (size_t i = 0; i < buscas; i++)
+        alcancadas += salasAlcancaveis(&sessao, (int) (proximoAleatorio() % n));
+    terminarMedicao("salasAlcancaveis", alcancadas);
+    liberarSessao(&sessao);
+
+    iniciarMedicao();
+    prepararRotas(0);
+    terminarMedicao("prepararRotas", n);
+
+    iniciarMedicao();
+    size_t emOrdem = 0;
+    for (int s = primeiraSalaEmOrdem(0); s != SALA_NENHUMA; s = proximaSalaEmOrdem(s)) emOrdem++;
+    terminarMedicao("percorrerSalasEmOrdem", emOrdem);
+    if (emOrdem != n) fprintf(stderr, "aviso: %zu de %zu salas no percurso em ordem\n", emOrdem, n);
+
+    size_t consultas = 1000000;
+    long soma = 0;
+    iniciarMedicao();
+    for (size_t i = 0; i < consultas; i++)
+        soma += ancestralComum((int) (proximoAleatorio() % n), (int) (proximoAleatorio() % n));
+    terminarMedicao("ancestralComum", consultas);
+
+    iniciarMedicao();
+    for (size_t i = 0; i < consultas; i++)
+        soma += distanciaSalas((int) (proximoAleatorio() % n), (int) (proximoAleatorio() % n));
+    terminarMedicao("distanciaSalas", consultas);
+
+    iniciarMedicao();
+    for (size_t i = 0; i < consultas; i++) {
+        snprintf(nome, sizeof(nome), "Sala %zu", (size_t) (proximoAleatorio() % n));
+        soma += buscarSalaPorNome(nome);
+    }
+    terminarMedicao("buscarSalaPorNome", consultas);
+    if (soma < 0) fprintf(stderr, "aviso: consulta de rota sem resposta\n");
+
+    iniciarMedicao();
+    liberarSalas();
+    terminarMedicao("liberarSalas", n);
+
+    // arquivo de mapa com a mesma árvore
+    char caminho[64];
+    snprintf(caminho, sizeof(caminho), "/tmp/benchmark_mestre_%d.mapa", (int) getpid());
+    FILE* f = fopen(caminho, "w");
+    if (!f) { printf("Erro ao gravar %s\n", caminho); exit(1); }
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, "Sala %zu|", i);
+        if (2 * i + 1 < n) fprintf(f, "%zu|", 2 * i + 1); else fprintf(f, "-|");
+        if (2 * i + 2 < n) fprintf(f, "%zu\n", 2 * i + 2); else fprintf(f, "-\n");
+    }
+    fclose(f);
+
+    iniciarMedicao();
+    if (!carregarMapaDeArquivo(caminho)) { printf("Erro ao carregar %s\n", caminho); exit(1); }
+    terminarMedicao("carregarMapaDeArquivo", n);
+    if ((size_t) totalSalas != n) fprintf(stderr, "aviso: %d de %zu salas carregadas\n", totalSalas, n);
+    unlink(caminho);
+    liberarSalas();
+}
+
+// Textos de pista em ordem alfabética: o índice vira parte ordenável do texto
+void textoSintetico(char* buf, size_t tam, uint32_t i) {
+    snprintf(buf, tam, "Pista %010u encontrada perto da lareira", i);
+}
+
+// Ordens de inserção das pistas: aleatória, ordenada e adversária
+// (zigue-zague: 0, n-1, 1, n-2, ... que degenera uma BST comum e força
+// rotações duplas na AVL)
+void gerarOrdem(uint32_t* ordem, size_t n, const char* tipo) {
+    if (strcmp(tipo, "aleatoria") == 0) {
+        for (size_t i = 0; i < n; i++) ordem[i] = (uint32_t) i;
+        embaralhar(ordem, n);
+    } else if (strcmp(tipo, "ordenada") == 0) {
+        for (size_t i = 0; i < n; i++) ordem[i] = (uint32_t) i;
+    } else {
+        size_t baixo = 0, alto = n;
+        for (size_t i = 0; i < n; i++) ordem[i] = (uint32_t) (i % 2 == 0 ? baixo++ : --alto);
+    }
+}
+
+// Busca com strcmp em cada nó, como antes dos prefixos em Pista: referência
+// para medir o ganho da comparação por prefixo e tamanho
+Pista* buscarPistaStrcmp(Sessao* sessao, Pista* raiz, const char* texto) {
+    while (raiz != NULL) {
+        int cmp = strcmp(texto, textoPista(&sessao->pool, raiz->pista));
+        if (cmp == 0) return raiz;
+        raiz = cmp < 0 ? raiz->esquerda : raiz->direita;
+    }
+    return NULL;
+}
+
+void benchPistas(size_t n) {
+    const char* ordens[] = { "aleatoria", "ordenada", "adversaria" };
+    uint32_t* ordem = (uint32_t*) malloc(n * sizeof(uint32_t));
+    char** textos = (char**) malloc(n * sizeof(char*));
+    if (!ordem || !textos) { printf("Erro malloc benchmark\n"); exit(1); }
+    char buf[128];
+    for (size_t i = 0; i < n; i++) {
+        textoSintetico(buf, sizeof(buf), (uint32_t) i);
+        textos[i] = strdup(buf);
+    }
+
+    for (int o = 0; o < 3; o++) {
+        char teste[64];
+        Sessao sessao;
+        iniciarSessao(&sessao, SALA_NENHUMA);
+        gerarOrdem(ordem, n, ordens[o]);
+
+        snprintf(teste, sizeof(teste), "inserirPista/%s", ordens[o]);
+        iniciarMedicao();
+        for (size_t i = 0; i < n; i++)
+            sessao.arvorePistas = inserirPista(&sessao, sessao.arvorePistas, textos[ordem[i]]);
+        terminarMedicao(teste, n);
+
+        snprintf(teste, sizeof(teste), "buscarPista/%s", ordens[o]);
+        iniciarMedicao();
+        size_t achadas = 0;
+        for (size_t i = 0; i < n; i++)
+            achadas += buscarPista(&sessao, sessao.arvorePistas, textos[ordem[i]]) != NULL;
+        terminarMedicao(teste, n);
+        if (achadas != n) fprintf(stderr, "aviso: %zu de %zu pistas encontradas\n", achadas, n);
+
+        if (o == 0) {
+            iniciarMedicao();
+            achadas = 0;
+            for (size_t i = 0; i < n; i++)
+                achadas += buscarPistaStrcmp(&sessao, sessao.arvorePistas, textos[ordem[i]]) != NULL;
+            terminarMedicao("buscarPista/strcmp", n);
+            if (achadas != n) fprintf(stderr, "aviso: %zu de %zu pistas encontradas\n", achadas, n);
+
+            silenciarSaida();
+            iniciarMedicao();
+            listarPistas(&sessao, sessao.arvorePistas);
+            restaurarSaida();
+            terminarMedicao("listarPistas", n);
+
+            formatoSaida = FORMATO_TSV;
+            silenciarSaida();
+            iniciarMedicao();
+            listarPistas(&sessao, sessao.arvorePistas);
+            restaurarSaida();
+            terminarMedicao("listarPistas/tsv", n);
+            formatoSaida = FORMATO_TEXTO;
+
+            // prefixos de 8 dígitos: cada consulta devolve até 100 pistas
+            size_t consultas = 1000, devolvidas = 0;
+            silenciarSaida();
+            iniciarMedicao();
+            for (size_t q = 0; q < consultas; q++) {
+                snprintf(buf, sizeof(buf), "Pista %08u", (unsigned) (proximoAleatorio() % (n / 100 + 1)));
+                devolvidas += escreverPistasComPrefixo(&sessao, sessao.arvorePistas, buf, saidaPadrao(&sessao));
+                descarregarSaida(&sessao.saida);
+            }
+            restaurarSaida();
+            terminarMedicao("buscarPrefixo", consultas);
+            if (devolvidas == 0) fprintf(stderr, "aviso: nenhuma pista por prefixo\n");
+
+            // trechos: cada consulta varre todo o bloco de textos do pool
+            consultas = 16;
+            silenciarSaida();
+            iniciarMedicao();
+            for (size_t q = 0; q < consultas; q++) {
+                snprintf(buf, sizeof(buf), "%07u", (unsigned) (proximoAleatorio() % (n / 1000 + 1)));
+                escreverPistasComTrecho(&sessao, buf, saidaPadrao(&sessao));
+                descarregarSaida(&sessao.saida);
+            }
+            restaurarSaida();
+            terminarMedicao("buscarTrecho", consultas);
+
+            // páginas de TAM_PAGINA_PISTAS a partir de uma pista qualquer
+            consultas = 100000;
+            size_t paginas = 0;
+            silenciarSaida();
+            iniciarMedicao();
+            for (size_t q = 0; q < consultas; q++) {
+                int haMais;
+                paginas += escreverPaginaPistas(&sessao, sessao.arvorePistas, textos[proximoAleatorio() % n],
+                                                TAM_PAGINA_PISTAS, saidaPadrao(&sessao), &haMais) != NULL;
+                descarregarSaida(&sessao.saida);
+            }
+            restaurarSaida();
+            terminarMedicao("paginarPistas", consultas);
+            if (paginas == 0) fprintf(stderr, "aviso: nenhuma página de pistas\n");
+        }
+
+        snprintf(teste, sizeof(teste), "liberarPistas/%s", ordens[o]);
+        iniciarMedicao();
+        liberarSessao(&sessao);
+        terminarMedicao(teste, n);
+    }
+
+    // carga em lote: um lote só e depois metade na árvore e a outra metade intercalada
+    gerarOrdem(ordem, n, "aleatoria");
+    const char** lote = (const char**) malloc(n * sizeof(char*));
+    if (!lote) { printf("Erro malloc benchmark\n"); exit(1); }
+    for (size_t i = 0; i < n; i++) lote[i] = textos[ordem[i]];
+    Sessao sessao;
+    iniciarSessao(&sessao, SALA_NENHUMA);
+    iniciarMedicao();
+    size_t novas = importarPistas(&sessao, lote, n);
+    terminarMedicao("importarPistas", n);
+    if (novas != n) fprintf(stderr, "aviso: %zu de %zu pistas importadas\n", novas, n);
+    reiniciarSessao(&sessao, SALA_NENHUMA);
+
+    importarPistas(&sessao, lote, n / 2);
+    iniciarMedicao();
+    importarPistas(&sessao, lote + n / 2, n - n / 2);
+    terminarMedicao("importarPistas/intercalar", n - n / 2);
+    liberarSessao(&sessao);
+    free(lote);
+
+    for (size_t i = 0; i < n; i++) free(textos[i]);
+    free(textos);
+    free(ordem);
+}
+
+// Nomes de suspeitos: aleatórios, ou anagramas de uma mesma palavra, que
+// têm a mesma soma ASCII e caíam todos na mesma bucket com o hash antigo
+void gerarNomes(char (*nomes)[MAX_NOME], size_t n, int colidentes) {
+    char base[] = "abcdefghijklm";
+    size_t tam = strlen(base);
+    for (size_t i = 0; i < n; i++) {
+        if (colidentes) {
+            // permutação de número i (sistema fatorial), todas distintas
+            char resto[sizeof(base)];
+            memcpy(resto, base, sizeof(base));
+            size_t k = i, restantes = tam;
+            for (size_t pos = 0; pos < tam; pos++) {
+                size_t j = k % restantes;
+                k /= restantes;
+                nomes[i][pos] = resto[j];
+                memmove(resto + j, resto + j + 1, restantes - j);
+                restantes--;
+            }
+            nomes[i][tam] = '\0';
+        } else {
+            snprintf(nomes[i], MAX_NOME, "Suspeito %016llx", (unsigned long long) proximoAleatorio());
+        }
+    }
+}
+
+void benchSuspeitos(size_t associacoes) {
+    size_t numSuspeitos = associacoes / 4 > 0 ? associacoes / 4 : 1;
+    size_t numPistas = 1024;
+    char (*nomes)[MAX_NOME] = malloc(numSuspeitos * sizeof(*nomes));
+    if (!nomes) { printf("Erro malloc benchmark\n"); exit(1); }
+    char buf[128];
+
+    for (int colidentes = 0; colidentes < 2; colidentes++) {
+        const char* tipo = colidentes ? "anagramas" : "aleatorios";
+        char teste[64];
+        gerarNomes(nomes, numSuspeitos, colidentes);
+
+        Sessao sessao;
+        iniciarSessao(&sessao, SALA_NENHUMA);
+        uint32_t* ids = (uint32_t*) malloc(numPistas * sizeof(uint32_t));
+        if (!ids) { printf("Erro malloc benchmark\n"); exit(1); }
+        for (size_t i = 0; i < numPistas; i++) {
+            textoSintetico(buf, sizeof(buf), (uint32_t) i);
+            ids[i] = internarPista(&sessao.pool, buf);
+        }
+
+        snprintf(teste, sizeof(teste), "inserirHash/%s", tipo);
+        iniciarMedicao();
+        for (size_t i = 0; i < associacoes; i++) {
+            size_t s = proximoAleatorio() % numSuspeitos;
+            inserirHashId(&sessao, nomes[s], ids[i % numPistas]);
+        }
+        terminarMedicao(teste, associacoes);
+
+        snprintf(teste, sizeof(teste), "buscarSuspeito/%s", tipo);
+        iniciarMedicao();
+        for (size_t i = 0; i < associacoes; i++)
+            buscarSuspeito(&sessao, nomes[proximoAleatorio() % numSuspeitos]);
+        terminarMedicao(teste, associacoes);
+
+        snprintf(teste, sizeof(teste), "suspeitoMaisProvavel/%s", tipo);
+        silenciarSaida();
+        iniciarMedicao();
+        for (size_t i = 0; i < associacoes; i++) suspeitoMaisProvavel(&sessao);
+        restaurarSaida();
+        terminarMedicao(teste, associacoes);
+
+        snprintf(teste, sizeof(teste), "exportarSessao/%s", tipo);
+        formatoSaida = FORMATO_TSV;
+        iniciarMedicao();
+        exportarSessao(&sessao, "/dev/null");
+        terminarMedicao(teste, associacoes);
+        formatoSaida = FORMATO_TEXTO;
+
+        snprintf(teste, sizeof(teste), "liberarHash/%s", tipo);
+        iniciarMedicao();
+        liberarSessao(&sessao);
+        terminarMedicao(teste, associacoes);
+        free(ids);
+    }
+    free(nomes);
+}
+
+// Snapshot: grava uma investigação com 'associacoes' relações e a retoma
+void benchSnapshot(size_t associacoes) {
+    size_t numSuspeitos = associacoes / 4 > 0 ? associacoes / 4 : 1;
+    size_t numPistas = associacoes / 2 > 0 ? associacoes / 2 : 1;
+    char (*nomes)[MAX_NOME] = malloc(numSuspeitos * sizeof(*nomes));
+    uint32_t* ids = (uint32_t*) malloc(numPistas * sizeof(uint32_t));
+    if (!nomes || !ids) { printf("Erro malloc benchmark\n"); exit(1); }
+    char buf[128], caminho[64];
+    snprintf(caminho, sizeof(caminho), "/tmp/benchmark_mestre_%d.dqs", (int) getpid());
+    gerarNomes(nomes, numSuspeitos, 0);
+
+    Sessao sessao;
+    iniciarSessao(&sessao, SALA_NENHUMA);
+    for (size_t i = 0; i < numPistas; i++) {
+        textoSintetico(buf, sizeof(buf), (uint32_t) i);
+        ids[i] = internarPista(&sessao.pool, buf);
+        sessao.arvorePistas = inserirPistaId(&sessao, sessao.arvorePistas, ids[i]);
+    }
+    for (size_t i = 0; i < associacoes; i++)
+        inserirHashId(&sessao, nomes[proximoAleatorio() % numSuspeitos], ids[proximoAleatorio() % numPistas]);
+
+    iniciarMedicao();
+    if (!gravarSnapshot(&sessao, caminho)) { printf("Erro ao gravar %s\n", caminho); exit(1); }
+    terminarMedicao("gravarSnapshot", associacoes);
+
+    Sessao retomada;
+    iniciarSessao(&retomada, SALA_NENHUMA);
+    iniciarMedicao();
+    if (!carregarSnapshot(&retomada, caminho)) { printf("Erro ao carregar %s\n", caminho); exit(1); }
+    terminarMedicao("carregarSnapshot", associacoes);
+    if (retomada.relacoes.quantidade != sessao.relacoes.quantidade
+        || retomada.tabela.quantidade != sessao.tabela.quantidade
+        || retomada.ranking[0] == NULL || strcmp(retomada.ranking[0]->nome, sessao.ranking[0]->nome) != 0
+        || alturaPista(retomada.arvorePistas) > alturaPista(sessao.arvorePistas))
+        fprintf(stderr, "aviso: snapshot retomado difere do original\n");
+
+    unlink(caminho);
+    liberarSessao(&retomada);
+    liberarSessao(&sessao);
+    free(ids);
+    free(nomes);
+}
+
+// Importação: grava um CSV com 'associacoes' linhas suspeito,pista e mede a
+// ingestão em blocos, com a mesma distribuição do benchSuspeitos
+void benchImportacao(size_t associacoes) {
+    size_t numSuspeitos = associacoes / 4 > 0 ? associacoes / 4 : 1;
+    size_t numPistas = associacoes / 2 > 0 ? associacoes / 2 : 1;
+    char (*nomes)[MAX_NOME] = malloc(numSuspeitos * sizeof(*nomes));
+    if (!nomes) { printf("Erro malloc benchmark\n"); exit(1); }
+    char buf[128], caminho[64];
+    snprintf(caminho, sizeof(caminho), "/tmp/benchmark_mestre_%d.csv", (int) getpid());
+    gerarNomes(nomes, numSuspeitos, 0);
+
+    FILE* f = fopen(caminho, "w");
+    if (!f) { printf("Erro ao gravar %s\n", caminho); exit(1); }
+    fprintf(f, "suspeito,pista\n");
+    for (size_t i = 0; i < associacoes; i++) {
+        textoSintetico(buf, sizeof(buf), (uint32_t) (proximoAleatorio() % numPistas));
+        fprintf(f, "%s,%s\n", nomes[proximoAleatorio() % numSuspeitos], buf);
+    }
+    fclose(f);
+
+    Sessao sessao;
+    EstatImportacao est;
+    iniciarSessao(&sessao, SALA_NENHUMA);
+    iniciarMedicao();
+    if (!importarAssociacoes(&sessao, caminho, &est)) { printf("Erro ao carregar %s\n", caminho); exit(1); }
+    terminarMedicao("importarAssociacoes", associacoes);
+    if (est.linhas != associacoes || est.invalidas != 0)
+        fprintf(stderr, "aviso: %zu de %zu linhas importadas\n", est.linhas - est.invalidas, associacoes);
+
+    unlink(caminho);
+    liberarSessao(&sessao);
+    free(nomes);
+}
+
+// Tabela compartilhada: estresse com escritores, removedores e leitores
+// simultâneos (confere invariantes) e vazão de uma carga 90% leitura /
+// 10% escrita com 1, 2, 4 e 8 threads.
+#define PISTAS_COMPARTILHADA 1024
+
+typedef struct TrabalhoCompartilhada {
+    pthread_t thread;
+    TabelaCompartilhada* tabela;
+    char (*nomes)[MAX_NOME];
+    size_t numSuspeitos;
+    const uint32_t* pistas;
+    int indice;                // thread w de ..., também semente do gerador
+    size_t operacoes;
+    _Atomic int* escritoresAtivos;
+    size_t erros;
+} TrabalhoCompartilhada;
+
+static inline uint64_t aleatorioLocal(uint64_t* estado) {
+    *estado ^= *estado >> 12;
+    *estado ^= *estado << 25;
+    *estado ^= *estado >> 27;
+    return *estado * 2685821657736338717ULL;
+}
+
+// Pistas esperadas do suspeito i: três ids, possivelmente repetidos
+size_t pistaEsperada(size_t i, int k) {
+    static const size_t passos[] = { 1, 7, 13 };
+    return i * passos[k] % PISTAS_COMPARTILHADA;
+}
+
+size_t pistasEsperadas(size_t i) {
+    size_t a = pistaEsperada(i, 0), b = pistaEsperada(i, 1), c = pistaEsperada(i, 2);
+    return 1 + (b != a) + (c != a && c != b);
+}
+
+// Escritor: todas as associações, a partir de um ponto diferente por thread
+// (as threads repetem umas as outras), e suspeitos temporários removidos logo depois
+void* escreverCompartilhada(void* arg) {
+    TrabalhoCompartilhada* w = (TrabalhoCompartilhada*) arg;
+    char nome[MAX_NOME];
+    size_t inicio = w->numSuspeitos * (size_t) w->indice / 4;
+    for (size_t j = 0; j < w->numSuspeitos; j++) {
+        size_t i = (inicio + j) % w->numSuspeitos;
+        for (int k = 0; k < 3; k++)
+            associarCompartilhado(w->tabela, w->nomes[i], w->pistas[pistaEsperada(i, k)]);
+        if (j % 8 == 0) {
+            snprintf(nome, sizeof(nome), "Temporário %d-%zu", w->indice, j);
+            associarCompartilhado(w->tabela, nome, w->pistas[j % PISTAS_COMPARTILHADA]);
+            if (!removerSuspeitoCompartilhado(w->tabela, nome)) w->erros++;
+        }
+        w->operacoes += 3;
+    }
+    atomic_fetch_sub(w->escritoresAtivos, 1);
+    return NULL;
+}
+
+// Leitor: enquanto houver escritores, consulta suspeitos e confere que a
+// contagem nunca passa do esperado nem da lista publicada; às vezes lista tudo
+void* lerCompartilhada(void* arg) {
+    TrabalhoCompartilhada* w = (TrabalhoCompartilhada*) arg;
+    int p = entrarNaTabela(w->tabela);
+    uint64_t semente = 0x9E3779B97F4A7C15ULL * (uint64_t) (w->indice + 1);
+    Saida out = { 0 };
+    int nulo = open("/dev/null", O_WRONLY);
+    iniciarSaida(&out, nulo, FORMATO_TSV);
+    while (atomic_load(w->escritoresAtivos) > 0) {
+        size_t i = aleatorioLocal(&semente) % w->numSuspeitos;
+        iniciarLeitura(w->tabela, p);
+        SuspeitoCompartilhado* s = buscarSuspeitoCompartilhado(w->tabela, w->nomes[i]);
+        if (s != NULL) {
+            int n = atomic_load(&s->numPistas);
+            int naLista = 0;
+            for (RelacaoCompartilhada* r = atomic_load(&s->pistas); r != NULL; r = r->prox) naLista++;
+            if (strcmp(s->nome, w->nomes[i]) != 0 || n > (int) pistasEsperadas(i) || naLista < n) w->erros++;
+        }
+        terminarLeitura(w->tabela, p);
+        if (++w->operacoes % 65536 == 0) {
+            escreverTabelaCompartilhada(w->tabela, p, &out);
+            descarregarSaida(&out);
+        }
+    }
+    liberarSaida(&out);
+    close(nulo);
+    sairDaTabela(w->tabela, p);
+    return NULL;
+}
+
+// Carga mista: 90% consultas sem trava, 10% associações
+void* misturarCompartilhada(void* arg) {
+    TrabalhoCompartilhada* w = (TrabalhoCompartilhada*) arg;
+    int p = entrarNaTabela(w->tabela);
+    uint64_t semente = 0x9E3779B97F4A7C15ULL * (uint64_t) (w->indice + 1);
+    size_t achados = 0;
+    for (size_t o = 0; o < w->operacoes; o++) {
+        uint64_t x = aleatorioLocal(&semente);
+        size_t i = (x >> 8) % w->numSuspeitos;
+        if (x % 10 == 0) associarCompartilhado(w->tabela, w->nomes[i], w->pistas[(x >> 40) % PISTAS_COMPARTILHADA]);
+        else achados += consultarSuspeitoCompartilhado(w->tabela, p, w->nomes[i]) >= 0;
+    }
+    w->erros = achados == 0;
+    sairDaTabela(w->tabela, p);
+    return NULL;
+}
+
+void benchCompartilhada(size_t associacoes) {
+    size_t numSuspeitos = associacoes / 4 > 0 ? associacoes / 4 : 1;
+    char (*nomes)[MAX_NOME] = malloc(numSuspeitos * sizeof(*nomes));
+    uint32_t* pistas = (uint32_t*) malloc(PISTAS_COMPARTILHADA * sizeof(uint32_t));
+    if (!nomes || !pistas) { printf("Erro malloc benchmark\n"); exit(1); }
+    gerarNomes(nomes, numSuspeitos, 0);
+    // ids no pool de regras, que a listagem usa para achar os textos
+    char buf[128];
+    for (size_t i = 0; i < PISTAS_COMPARTILHADA; i++) {
+        textoSintetico(buf, sizeof(buf), (uint32_t) i);
+        pistas[i] = internarPista(&poolRegras, buf);
+    }
+
+    // estresse: 4 escritores e 4 leitores; no fim a tabela tem de bater com o esperado
+    TabelaCompartilhada tabela;
+    iniciarTabelaCompartilhada(&tabela);
+    _Atomic int escritoresAtivos = 4;
+    TrabalhoCompartilhada ws[8];
+    iniciarMedicao();
+    for (int i = 0; i < 8; i++) {
+        ws[i] = (TrabalhoCompartilhada) { .tabela = &tabela, .nomes = nomes, .numSuspeitos = numSuspeitos,
+                                          .pistas = pistas, .indice = i % 4,
+                                          .escritoresAtivos = &escritoresAtivos };
+        if (pthread_create(&ws[i].thread, NULL, i < 4 ? escreverCompartilhada : lerCompartilhada, &ws[i]) != 0) {
+            printf("Erro ao criar thread do benchmark\n");
+            exit(1);
+        }
+    }
+    size_t operacoes = 0, erros = 0;
+    for (int i = 0; i < 8; i++) {
+        pthread_join(ws[i].thread, NULL);
+        operacoes += ws[i].operacoes;
+        erros += ws[i].erros;
+    }
+    terminarMedicao("estresseCompartilhada", operacoes);
+    // os leitores já saíram: o primeiro lugar é reaproveitado
+    int p = entrarNaTabela(&tabela);
+    if (p != 0) erros++;
+    for (size_t i = 0; i < numSuspeitos; i++)
+        if (consultarSuspeitoCompartilhado(&tabela, p, nomes[i]) != (int) pistasEsperadas(i)) erros++;
+    if (atomic_load(&tabela.quantidade) != numSuspeitos) erros++;
+    // os temporários removidos não deixam chaves nos conjuntos das faixas
+    size_t chaves = 0, esperadas = 0;
+    for (int i = 0; i < FAIXAS_COMPARTILHADA; i++) chaves += tabela.faixas[i].relacoes.quantidade;
+    for (size_t i = 0; i < numSuspeitos; i++) esperadas += pistasEsperadas(i);
+    if (chaves != esperadas) erros++;
+    sairDaTabela(&tabela, p);
+    if (erros) {
+        fprintf(stderr, "erro: %zu inconsistências na tabela compartilhada\n", erros);
+        exit(1);
+    }
+    liberarTabelaCompartilhada(&tabela);
+
+    // vazão da carga mista por número de threads: ns_por_op é tempo de parede / operações totais
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        char teste[64];
+        iniciarTabelaCompartilhada(&tabela);
+        for (size_t i = 0; i < numSuspeitos; i++)
+            associarCompartilhado(&tabela, nomes[i], pistas[i % PISTAS_COMPARTILHADA]);
+        snprintf(teste, sizeof(teste), "mistoCompartilhada/%dthreads", threads);
+        iniciarMedicao();
+        for (int i = 0; i < threads; i++) {
+            ws[i] = (TrabalhoCompartilhada) { .tabela = &tabela, .nomes = nomes, .numSuspeitos = numSuspeitos,
+                                              .pistas = pistas, .indice = i, .operacoes = associacoes };
+            if (pthread_create(&ws[i].thread, NULL, misturarCompartilhada, &ws[i]) != 0) {
+                printf("Erro ao criar thread do benchmark\n");
+                exit(1);
+            }
+        }
+        for (int i = 0; i < threads; i++) pthread_join(ws[i].thread, NULL);
+        terminarMedicao(teste, associacoes * (size_t) threads);
+        liberarTabelaCompartilhada(&tabela);
+    }
+    free(pistas);
+    free(nomes);
+}
+
+int main(int argc, char* argv[]) {
+    size_t salas = 1000000, pistas = 1000000, associacoes = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--salas") == 0 && i + 1 < argc) salas = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--pistas") == 0 && i + 1 < argc) pistas = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--associacoes") == 0 && i + 1 < argc) associacoes = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) estadoAleatorio = strtoull(argv[++i], NULL, 10) | 1;
+    }
+
+    iniciarPool(&poolRegras, NULL);
+    printf("teste\tn\tns_por_op\trss_pico_kb\tmallocs\n");
+    benchMapa(salas);
+    benchPistas(pistas);
+    benchSuspeitos(associacoes);
+    benchSnapshot(associacoes);
+    benchImportacao(associacoes);
+    benchCompartilhada(associacoes);
+    liberarRegras();
+    return 0;
+}
@@ -0,0 +1,208 @@
+// Desafio Detective Quest
+// Cliente de carga do servidor do Nível Mestre (nivel_mestre --servidor):
+// abre muitas conexões ao mesmo tempo e, em cada uma, manda comandos
+// aleatórios, um de cada vez, esperando a resposta (que termina no prompt)
+// antes do próximo. Mede a latência de ida e volta de cada comando.
+//
+// Compilar: gcc -O2 cliente_carga.c -o cliente_carga
+// Uso:      ./cliente_carga [--endereco porta|caminho] [--conexoes N] [--comandos N] [--semente S]
+//
+// Saída: conexões, comandos, tempo, comandos por segundo e latências
+// (média, p50, p99 e máxima) em microssegundos.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define PROMPT_SERVIDOR "\n> "
+#define TAM_PROMPT 3
+#define MAX_EVENTOS 256
+#define TAM_LEITURA 65536
+
+// Comandos sorteados: movimentos, listagens e buscas (nunca 's')
+const char* comandosCarga[] = {
+    "e\n", "d\n", "e\n", "d\n", "o 1\n", "a\n", "p\n", "h\n", "i\n", "r\n", "f a*\n", "l -\n",
+};
+#define NUM_COMANDOS_CARGA (sizeof(comandosCarga) / sizeof(comandosCarga[0]))
+
+typedef struct Jogador {
+    int fd;
+    long restantes;            // comandos ainda por enviar
+    int esperando;             // comando enviado, resposta incompleta
+    char fim[TAM_PROMPT];      // últimos bytes recebidos
+    double enviadoEm;
+} Jogador;
+
+// Gerador pseudoaleatório determinístico (xorshift64*)
+uint64_t estadoAleatorio = 88172645463325252ULL;
+
+uint64_t proximoAleatorio() {
+    estadoAleatorio ^= estadoAleatorio >> 12;
+    estadoAleatorio ^= estadoAleatorio << 25;
+    estadoAleatorio ^= estadoAleatorio >> 27;
+    return estadoAleatorio * 2685821657736338717ULL;
+}
+
+double agoraSegundos() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Conecta ao servidor: porta TCP em 127.0.0.1 ou caminho de socket Unix
+int conectar(const char* endereco) {
+    int fd;
+    if (strchr(endereco, '/') != NULL) {
+        struct sockaddr_un un = { .sun_family = AF_UNIX };
+        if (strlen(endereco) >= sizeof(un.sun_path)) return -1;
+        strcpy(un.sun_path, endereco);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, (struct sockaddr*) &un, sizeof(un)) < 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_in in = { .sin_family = AF_INET };
+        in.sin_port = htons((uint16_t) atoi(endereco));
+        in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, (struct sockaddr*) &in, sizeof(in)) < 0) {
+            close(fd);
+            return -1;
+        }
+        int um = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Manda o próximo comando sorteado (as linhas são curtas: cabem no socket)
+int enviarComando(Jogador* j) {
+    const char* cmd = comandosCarga[proximoAleatorio() % NUM_COMANDOS_CARGA];
+    j->enviadoEm = agoraSegundos();
+    j->esperando = 1;
+    j->restantes--;
+    return send(j->fd, cmd, strlen(cmd), MSG_NOSIGNAL) == (ssize_t) strlen(cmd);
+}
+
+// Guarda os últimos TAM_PROMPT bytes recebidos para reconhecer o fim da resposta
+void registrarFim(Jogador* j, const char* dados, ssize_t n) {
+    if (n >= TAM_PROMPT) {
+        memcpy(j->fim, dados + n - TAM_PROMPT, TAM_PROMPT);
+        return;
+    }
+    memmove(j->fim, j->fim + n, TAM_PROMPT - n);
+    memcpy(j->fim + TAM_PROMPT - n, dados, n);
+}
+
+int compararDouble(const void* a, const void* b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[]) {
+    const char* endereco = "7070";
+    long conexoes = 100;
+    long comandos = 1000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--endereco") == 0 && i + 1 < argc) endereco = argv[++i];
+        else if (strcmp(argv[i], "--conexoes") == 0 && i + 1 < argc) conexoes = atol(argv[++i]);
+        else if (strcmp(argv[i], "--comandos") == 0 && i + 1 < argc) comandos = atol(argv[++i]);
+        else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) estadoAleatorio = strtoull(argv[++i], NULL, 10) | 1;
+    }
+    if (conexoes < 1) conexoes = 1;
+    if (comandos < 0) comandos = 0;
+
+    // Cada conexão é um descritor: sobe o limite até o máximo permitido
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    Jogador* jogadores = (Jogador*) calloc(conexoes, sizeof(Jogador));
+    double* latencias = (double*) malloc((size_t)(conexoes * comandos + 1) * sizeof(double));
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (!jogadores || !latencias || ep < 0) { printf("Erro malloc cliente de carga\n"); return 1; }
+
+    for (long i = 0; i < conexoes; i++) {
+        Jogador* j = &jogadores[i];
+        j->fd = conectar(endereco);
+        if (j->fd < 0) {
+            printf("Não foi possível conectar em %s (conexão %ld): %s\n", endereco, i + 1, strerror(errno));
+            return 1;
+        }
+        j->restantes = comandos;
+        j->esperando = 1;      // a saudação termina no primeiro prompt
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = j };
+        epoll_ctl(ep, EPOLL_CTL_ADD, j->fd, &ev);
+    }
+
+    size_t medidas = 0;
+    long ativas = conexoes;
+    char buf[TAM_LEITURA];
+    struct epoll_event eventos[MAX_EVENTOS];
+    double t0 = agoraSegundos();
+    while (ativas > 0) {
+        int n = epoll_wait(ep, eventos, MAX_EVENTOS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int e = 0; e < n; e++) {
+            Jogador* j = (Jogador*) eventos[e].data.ptr;
+            ssize_t lido = recv(j->fd, buf, sizeof(buf), 0);
+            if (lido < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            int fim = lido <= 0;
+            if (!fim) {
+                registrarFim(j, buf, lido);
+                if (!j->esperando || memcmp(j->fim, PROMPT_SERVIDOR, TAM_PROMPT) != 0) continue;
+                if (j->restantes < comandos) latencias[medidas++] = agoraSegundos() - j->enviadoEm;
+                j->esperando = 0;
+                fim = j->restantes == 0 || !enviarComando(j);
+            }
+            if (fim) {
+                if (lido <= 0 || j->restantes > 0) printf("Conexão encerrada pelo servidor\n");
+                close(j->fd);
+                ativas--;
+            }
+        }
+    }
+    double parede = agoraSegundos() - t0;
+
+    qsort(latencias, medidas, sizeof(double), compararDouble);
+    double soma = 0;
+    for (size_t i = 0; i < medidas; i++) soma += latencias[i];
+
+    printf("=== Cliente de carga ===\n");
+    printf("Conexões: %ld\n", conexoes);
+    printf("Comandos: %zu\n", medidas);
+    printf("Tempo: %.3f s\n", parede);
+    printf("Comandos por segundo: %.0f\n", parede > 0 ? medidas / parede : 0.0);
+    if (medidas > 0) {
+        printf("Latência média: %.1f us\n", soma * 1e6 / medidas);
+        printf("Latência p50: %.1f us\n", latencias[medidas / 2] * 1e6);
+        printf("Latência p99: %.1f us\n", latencias[(size_t)(medidas * 0.99)] * 1e6);
+        printf("Latência máxima: %.1f us\n", latencias[medidas - 1] * 1e6);
+    }
+
+    close(ep);
+    free(latencias);
+    free(jogadores);
+    return 0;
+}
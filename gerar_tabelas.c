@@ -0,0 +1,279 @@
+// Desafio Detective Quest
+// Gerador das tabelas da mansão: lê a descrição da mansão (mansao.txt), monta
+// mapa, grafo, rotas e regras com as próprias funções do Nível Mestre e grava
+// o resultado como vetores static const num cabeçalho C (mansao_tabelas.h).
+// Os três programas do jogo incluem o cabeçalho e começam sem montar nada.
+//
+// Compilar: gcc -O2 -pthread gerar_tabelas.c -o gerar_tabelas
+// Uso:      ./gerar_tabelas mansao.txt mansao_tabelas.h
+//
+// Formato da descrição: as linhas 'sala|...' seguem o formato do arquivo de
+// mapa (--mapa) e as linhas 'pista|...' e 'suspeito|...' o do arquivo de
+// regras (--regras). Linhas vazias ou iniciadas por '#' são ignoradas.
+
+#define NIVEL_MESTRE_SEM_MAIN
+#define NIVEL_MESTRE_SEM_TABELAS
+#include "nivel_mestre.c"
+
+#include <inttypes.h>
+
+#define PREFIXO_SALA "sala|"
+#define POR_LINHA_TABELA 10
+
+// Escreve o texto dentro de um literal de string C; bytes de controle, aspas
+// e barras saem como escapes octais de três dígitos (um dígito depois não
+// os estende)
+void escreverEscapado(FILE* f, const char* texto, size_t tam) {
+    for (size_t i = 0; i < tam; i++) {
+        unsigned char c = (unsigned char) texto[i];
+        if (c < 0x20 || c == 0x7f || c == '"' || c == '\\') fprintf(f, "\\%03o", c);
+        else fputc(c, f);
+    }
+}
+
+void escreverLiteral(FILE* f, const char* texto, size_t tam) {
+    fputc('"', f);
+    escreverEscapado(f, texto, tam);
+    fputc('"', f);
+}
+
+// Escreve um bloco de textos terminados em '\0' (nomes das salas, pool das
+// regras), um texto por linha; sizeof(nome) - 1 é o tamanho do bloco
+void escreverBloco(FILE* f, const char* nome, const char* bloco, size_t usado) {
+    fprintf(f, "static const char %s[] =", nome);
+    if (usado == 0) fprintf(f, " \"\"");
+    for (size_t i = 0; i < usado;) {
+        size_t tam = strlen(bloco + i);
+        fprintf(f, "\n    \"");
+        escreverEscapado(f, bloco + i, tam);
+        fprintf(f, "\\000\"");
+        i += tam + 1;
+    }
+    fprintf(f, ";\n\n");
+}
+
+// Escreve um vetor de inteiros de 'tamElem' bytes. Formato: 'd' (int),
+// 'u' (sem sinal, 4 ou 8 bytes) ou 'x' (64 bits em hexadecimal). Vetores
+// vazios ganham um elemento 0, já que C não aceita vetor de tamanho zero.
+void escreverVetor(FILE* f, const char* tipo, const char* nome, const void* v, size_t n, size_t tamElem, char formato) {
+    fprintf(f, "static const %s %s[%zu] = {", tipo, nome, n ? n : 1);
+    if (n == 0) fprintf(f, " 0 ");
+    for (size_t i = 0; i < n; i++) {
+        const char* p = (const char*) v + i * tamElem;
+        if (i % (formato == 'x' ? POR_LINHA_TABELA / 2 : POR_LINHA_TABELA) == 0) fprintf(f, "\n   ");
+        if (tamElem == sizeof(uint32_t)) {
+            uint32_t x;
+            memcpy(&x, p, sizeof(x));
+            if (formato == 'd') fprintf(f, " %d,", (int32_t) x);
+            else fprintf(f, " %" PRIu32 ",", x);
+        } else {
+            uint64_t x;
+            memcpy(&x, p, sizeof(x));
+            if (formato == 'x') fprintf(f, " 0x%016" PRIx64 "ULL,", x);
+            else fprintf(f, " %" PRIu64 ",", x);
+        }
+    }
+    fprintf(f, n ? "\n};\n\n" : "};\n\n");
+}
+
+// Mapa com ponteiros para algoritmos_avancados.c e nivel_aventureiro.c: uma
+// macro que inicializa um vetor 't' de Sala { nome, esquerda, direita }
+void escreverMapaComPonteiros(FILE* f) {
+    fprintf(f, "// Mapa para os programas cuja Sala é { nome, esquerda, direita } com ponteiros\n");
+    fprintf(f, "// (algoritmos_avancados.c, nivel_aventureiro.c). Uso:\n");
+    fprintf(f, "//   static const Sala mansao[MANSAO_TOTAL_SALAS] = { MANSAO_SALAS(mansao) };\n");
+    fprintf(f, "// A sala 0 é o hall. Portas extras não entram: lá o mapa é só a árvore.\n");
+    fprintf(f, "#define MANSAO_TOTAL_SALAS %d\n", totalSalas);
+    fprintf(f, "#define MANSAO_SALAS(t)");
+    for (int s = 0; s < totalSalas; s++) {
+        fprintf(f, " \\\n    { ");
+        escreverLiteral(f, nomeSala(s), strlen(nomeSala(s)));
+        if (salas[s].esquerda == SALA_NENHUMA) fprintf(f, ", NULL");
+        else fprintf(f, ", &(t)[%d]", salas[s].esquerda);
+        if (salas[s].direita == SALA_NENHUMA) fprintf(f, ", NULL }");
+        else fprintf(f, ", &(t)[%d] }", salas[s].direita);
+        if (s + 1 < totalSalas) fputc(',', f);
+    }
+    fprintf(f, "\n\n");
+}
+
+// Regras: um RegraSala por sala com regra e as associações de todas as salas
+// num vetor só, encadeadas por ponteiros para os próprios elementos
+void escreverRegras(FILE* f, char** linhas, size_t numLinhas) {
+    fprintf(f, "static const char* const REGRAS_PADRAO[] = {\n");
+    for (size_t i = 0; i < numLinhas; i++) {
+        fprintf(f, "    ");
+        escreverLiteral(f, linhas[i], strlen(linhas[i]));
+        fprintf(f, ",\n");
+    }
+    fprintf(f, "    NULL\n};\n\n");
+
+    size_t numRegras = 0, numAssociacoes = 0;
+    for (int s = 0; regrasPorSala && s < totalSalas; s++) {
+        if (regrasPorSala[s] == NULL) continue;
+        numRegras++;
+        for (AssociacaoRegra* a = regrasPorSala[s]->associacoes; a; a = a->prox) numAssociacoes++;
+    }
+
+    fprintf(f, "static const AssociacaoRegra TABELA_ASSOCIACOES[%zu] = {\n", numAssociacoes ? numAssociacoes : 1);
+    if (numAssociacoes == 0) fprintf(f, "    { \"\", 0, NULL }\n");
+    size_t a = 0;
+    for (int s = 0; regrasPorSala && s < totalSalas; s++) {
+        if (regrasPorSala[s] == NULL) continue;
+        for (AssociacaoRegra* as = regrasPorSala[s]->associacoes; as; as = as->prox, a++) {
+            fprintf(f, "    { ");
+            escreverLiteral(f, as->suspeito, strlen(as->suspeito));
+            if (as->prox) fprintf(f, ", %" PRIu32 ", (AssociacaoRegra*) &TABELA_ASSOCIACOES[%zu] },\n", as->pista, a + 1);
+            else fprintf(f, ", %" PRIu32 ", NULL },\n", as->pista);
+        }
+    }
+    fprintf(f, "};\n\n");
+
+    fprintf(f, "static const RegraSala TABELA_REGRAS[%zu] = {\n", numRegras ? numRegras : 1);
+    if (numRegras == 0) fprintf(f, "    { ID_PISTA_NENHUMA, NULL, NULL }\n");
+    a = 0;
+    for (int s = 0; regrasPorSala && s < totalSalas; s++) {
+        const RegraSala* r = regrasPorSala[s];
+        if (r == NULL) continue;
+        fprintf(f, "    { ");
+        if (r->pista == ID_PISTA_NENHUMA) fprintf(f, "ID_PISTA_NENHUMA");
+        else fprintf(f, "%" PRIu32, r->pista);
+        size_t n = 0;
+        for (AssociacaoRegra* as = r->associacoes; as; as = as->prox) n++;
+        if (n == 0) fprintf(f, ", NULL, NULL },");
+        else fprintf(f, ", (AssociacaoRegra*) &TABELA_ASSOCIACOES[%zu], (AssociacaoRegra*) &TABELA_ASSOCIACOES[%zu] },",
+                     a, a + n - 1);
+        fprintf(f, "   // %s\n", nomeSala(s));
+        a += n;
+    }
+    fprintf(f, "};\n\n");
+
+    fprintf(f, "static RegraSala* const TABELA_REGRAS_POR_SALA[%d] = {\n", totalSalas);
+    size_t r = 0;
+    for (int s = 0; s < totalSalas; s++) {
+        if (regrasPorSala && regrasPorSala[s]) fprintf(f, "    (RegraSala*) &TABELA_REGRAS[%zu],\n", r++);
+        else fprintf(f, "    NULL,\n");
+    }
+    fprintf(f, "};\n\n");
+}
+
+// Grava o cabeçalho com tudo o que usarTabelasGeradas espera
+int gravarTabelas(const char* origem, const char* destino, char** linhasRegras, size_t numRegras) {
+    FILE* f = fopen(destino, "w");
+    if (!f) return 0;
+    fprintf(f, "// Gerado por gerar_tabelas.c a partir de %s: não edite à mão.\n", origem);
+    fprintf(f, "// Refazer: ./gerar_tabelas %s %s\n\n", origem, destino);
+    fprintf(f, "#ifndef MANSAO_TABELAS_H\n#define MANSAO_TABELAS_H\n\n#include <stddef.h>\n\n");
+    escreverMapaComPonteiros(f);
+
+    fprintf(f, "// Tabelas do Nível Mestre (tipos de nivel_mestre.c)\n#ifdef TABELAS_NIVEL_MESTRE\n\n");
+    fprintf(f, "#define TABELA_TOTAL_SALAS %d\n", totalSalas);
+    fprintf(f, "#define TABELA_TOTAL_PORTAS %zu\n", totalPortas);
+    fprintf(f, "#define TABELA_TAMANHO_PASSEIO %d\n", tamanhoPasseio);
+    fprintf(f, "#define TABELA_BLOCOS_PASSEIO %d\n", blocosPasseio);
+    fprintf(f, "#define TABELA_NIVEIS_ESPARSA %d\n", niveisEsparsa);
+    fprintf(f, "#define TABELA_TOTAL_TEXTOS %" PRIu32 "\n\n", poolRegras.quantidade);
+
+    // Conferidos por nivel_mestre.c, que recusa um cabeçalho gerado antes de
+    // uma mudança de tipos, de bloco do LCA ou de calcularHash
+    fprintf(f, "#define TABELA_TAM_SALA %zu\n", sizeof(Sala));
+    fprintf(f, "#define TABELA_POS_SALA_ESQUERDA %zu\n", offsetof(Sala, esquerda));
+    fprintf(f, "#define TABELA_POS_SALA_DIREITA %zu\n", offsetof(Sala, direita));
+    fprintf(f, "#define TABELA_TAM_REGRA_SALA %zu\n", sizeof(RegraSala));
+    fprintf(f, "#define TABELA_TAM_ASSOCIACAO_REGRA %zu\n", sizeof(AssociacaoRegra));
+    fprintf(f, "#define TABELA_BLOCO_LCA %d\n", TAM_BLOCO_LCA);
+    fprintf(f, "#define TABELA_HASH_PROVA 0x%016" PRIx64 "ULL   // calcularHash(TEXTO_PROVA_TABELAS)\n\n",
+            calcularHash(TEXTO_PROVA_TABELAS));
+
+    fprintf(f, "static const Sala TABELA_SALAS[%d] = {\n", totalSalas);
+    for (int s = 0; s < totalSalas; s++)
+        fprintf(f, "    { %" PRIu32 ", %d, %d },   // %s\n", salas[s].nome, salas[s].esquerda, salas[s].direita, nomeSala(s));
+    fprintf(f, "};\n\n");
+    escreverBloco(f, "TABELA_NOMES_SALAS", nomesSalas, usadoNomesSalas);
+    escreverVetor(f, "int", "TABELA_INDICE_NOMES", indiceNomesSalas, tamanhoIndiceNomes, sizeof(int), 'd');
+    escreverVetor(f, "int", "TABELA_INICIO_PORTAS", inicioPortas, (size_t) totalSalas + 1, sizeof(int), 'd');
+    escreverVetor(f, "int", "TABELA_DESTINO_PORTAS", destinoPortas, totalPortas, sizeof(int), 'd');
+    escreverVetor(f, "int", "TABELA_PAI", paiSala, totalSalas, sizeof(int), 'd');
+    escreverVetor(f, "int", "TABELA_PROFUNDIDADE", profundidadeSala, totalSalas, sizeof(int), 'd');
+    escreverVetor(f, "int", "TABELA_PRIMEIRA_NO_PASSEIO", primeiraNoPasseio, totalSalas, sizeof(int), 'd');
+    escreverVetor(f, "int", "TABELA_PASSEIO", passeioEuler, tamanhoPasseio, sizeof(int), 'd');
+    escreverVetor(f, "int", "TABELA_PROFUNDIDADE_NO_PASSEIO", profundidadeNoPasseio, tamanhoPasseio, sizeof(int), 'd');
+    escreverVetor(f, "int", "TABELA_MINIMO_DO_BLOCO", minimoDoBloco, blocosPasseio, sizeof(int), 'd');
+    escreverVetor(f, "int", "TABELA_ESPARSA", tabelaEsparsa, (size_t) niveisEsparsa * blocosPasseio, sizeof(int), 'd');
+
+    escreverBloco(f, "TABELA_TEXTOS_REGRAS", poolRegras.textos, poolRegras.usado);
+    escreverVetor(f, "size_t", "TABELA_INICIO_TEXTOS", poolRegras.inicio, poolRegras.quantidade, sizeof(size_t), 'u');
+    escreverVetor(f, "uint64_t", "TABELA_HASHES_TEXTOS", poolRegras.hashes, poolRegras.quantidade, sizeof(uint64_t), 'x');
+    escreverVetor(f, "uint32_t", "TABELA_INDICE_TEXTOS", poolRegras.indice, poolRegras.tamanhoIndice, sizeof(uint32_t), 'u');
+    escreverRegras(f, linhasRegras, numRegras);
+
+    fprintf(f, "#endif\n\n#endif\n");
+    int ok = ferror(f) == 0;
+    return fclose(f) == 0 && ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        printf("Uso: %s mansao.txt mansao_tabelas.h\n", argv[0]);
+        return 1;
+    }
+    size_t lido;
+    char* buf = lerArquivoInteiro(argv[1], &lido);
+    if (buf == NULL) {
+        printf("Não foi possível abrir %s\n", argv[1]);
+        return 1;
+    }
+
+    // Separa as salas (para carregarMapaDeTexto) das regras. As outras linhas
+    // viram linhas vazias no texto do mapa, para que os números de linha das
+    // mensagens de erro continuem os do arquivo.
+    char* mapa = (char*) malloc(lido + 1);
+    char** regras = (char**) malloc((lido / 2 + 1) * sizeof(char*));
+    if (!mapa || !regras) { printf("Erro malloc gerador\n"); return 1; }
+    size_t usadoMapa = 0, numRegras = 0;
+    for (char* linha = buf; linha < buf + lido;) {
+        char* fim = strchr(linha, '\n');
+        if (fim) *fim = '\0';
+        linha[strcspn(linha, "\r")] = '\0';
+        if (strncmp(linha, PREFIXO_SALA, strlen(PREFIXO_SALA)) == 0) {
+            size_t tam = strlen(linha) - strlen(PREFIXO_SALA);
+            memcpy(mapa + usadoMapa, linha + strlen(PREFIXO_SALA), tam);
+            usadoMapa += tam;
+        } else if (linha[0] != '\0' && linha[0] != '#') {
+            regras[numRegras++] = linha;
+        }
+        mapa[usadoMapa++] = '\n';
+        linha = fim ? fim + 1 : buf + lido;
+    }
+    mapa[usadoMapa] = '\0';
+
+    // Mesma sequência da inicialização com --mapa e --regras
+    if (!carregarMapaDeTexto(mapa, usadoMapa, argv[1])) {
+        printf("Descrição sem salas ou com sala inválida: %s\n", argv[1]);
+        return 1;
+    }
+    ordenarSalasEmLargura(0);
+    montarGrafoSalas();
+    prepararRotas(0);
+    iniciarPool(&poolRegras, NULL);
+    for (size_t i = 0; i < numRegras; i++) {
+        if (!adicionarRegra(regras[i])) {
+            printf("Regra inválida em %s: %s\n", argv[1], regras[i]);
+            return 1;
+        }
+    }
+
+    if (!gravarTabelas(argv[1], argv[2], regras, numRegras)) {
+        printf("Não foi possível gravar %s\n", argv[2]);
+        return 1;
+    }
+    printf("%s: %d salas, %zu portas, %zu regras, %" PRIu32 " textos de pistas\n",
+           argv[2], totalSalas, totalPortas, numRegras, poolRegras.quantidade);
+
+    free(mapa);
+    free(regras);
+    free(buf);
+    liberarRegras();
+    liberarSalas();
+    return 0;
+}
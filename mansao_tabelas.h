@@ -0,0 +1,171 @@
+// Gerado por gerar_tabelas.c a partir de mansao.txt: não edite à mão.
+// Refazer: ./gerar_tabelas mansao.txt mansao_tabelas.h
+
+#ifndef MANSAO_TABELAS_H
+#define MANSAO_TABELAS_H
+
+#include <stddef.h>
+
+// Mapa para os programas cuja Sala é { nome, esquerda, direita } com ponteiros
+// (algoritmos_avancados.c, nivel_aventureiro.c). Uso:
+//   static const Sala mansao[MANSAO_TOTAL_SALAS] = { MANSAO_SALAS(mansao) };
+// A sala 0 é o hall. Portas extras não entram: lá o mapa é só a árvore.
+#define MANSAO_TOTAL_SALAS 7
+#define MANSAO_SALAS(t) \
+    { "Hall de Entrada", &(t)[1], &(t)[2] }, \
+    { "Sala de Estar", &(t)[3], &(t)[4] }, \
+    { "Cozinha", &(t)[5], &(t)[6] }, \
+    { "Biblioteca", NULL, NULL }, \
+    { "Jardim de Inverno", NULL, NULL }, \
+    { "Sótão", NULL, NULL }, \
+    { "Quarto de Hóspedes", NULL, NULL }
+
+// Tabelas do Nível Mestre (tipos de nivel_mestre.c)
+#ifdef TABELAS_NIVEL_MESTRE
+
+#define TABELA_TOTAL_SALAS 7
+#define TABELA_TOTAL_PORTAS 6
+#define TABELA_TAMANHO_PASSEIO 13
+#define TABELA_BLOCOS_PASSEIO 1
+#define TABELA_NIVEIS_ESPARSA 1
+#define TABELA_TOTAL_TEXTOS 7
+
+#define TABELA_TAM_SALA 12
+#define TABELA_POS_SALA_ESQUERDA 4
+#define TABELA_POS_SALA_DIREITA 8
+#define TABELA_TAM_REGRA_SALA 24
+#define TABELA_TAM_ASSOCIACAO_REGRA 64
+#define TABELA_BLOCO_LCA 32
+#define TABELA_HASH_PROVA 0x2a1e3b614e385d10ULL   // calcularHash(TEXTO_PROVA_TABELAS)
+
+static const Sala TABELA_SALAS[7] = {
+    { 0, 1, 2 },   // Hall de Entrada
+    { 16, 3, 4 },   // Sala de Estar
+    { 30, 5, 6 },   // Cozinha
+    { 38, -1, -1 },   // Biblioteca
+    { 49, -1, -1 },   // Jardim de Inverno
+    { 67, -1, -1 },   // Sótão
+    { 75, -1, -1 },   // Quarto de Hóspedes
+};
+
+static const char TABELA_NOMES_SALAS[] =
+    "Hall de Entrada\000"
+    "Sala de Estar\000"
+    "Cozinha\000"
+    "Biblioteca\000"
+    "Jardim de Inverno\000"
+    "Sótão\000"
+    "Quarto de Hóspedes\000";
+
+static const int TABELA_INDICE_NOMES[16] = {
+    0, 0, 4, 0, 1, 2, 3, 6, 0, 0,
+    5, 0, 0, 7, 0, 0,
+};
+
+static const int TABELA_INICIO_PORTAS[8] = {
+    0, 2, 4, 6, 6, 6, 6, 6,
+};
+
+static const int TABELA_DESTINO_PORTAS[6] = {
+    1, 2, 3, 4, 5, 6,
+};
+
+static const int TABELA_PAI[7] = {
+    -1, 0, 0, 1, 1, 2, 2,
+};
+
+static const int TABELA_PROFUNDIDADE[7] = {
+    0, 1, 1, 2, 2, 2, 2,
+};
+
+static const int TABELA_PRIMEIRA_NO_PASSEIO[7] = {
+    0, 1, 7, 2, 4, 8, 10,
+};
+
+static const int TABELA_PASSEIO[13] = {
+    0, 1, 3, 1, 4, 1, 0, 2, 5, 2,
+    6, 2, 0,
+};
+
+static const int TABELA_PROFUNDIDADE_NO_PASSEIO[13] = {
+    0, 1, 2, 1, 2, 1, 0, 1, 2, 1,
+    2, 1, 0,
+};
+
+static const int TABELA_MINIMO_DO_BLOCO[1] = {
+    0,
+};
+
+static const int TABELA_ESPARSA[1] = {
+    0,
+};
+
+static const char TABELA_TEXTOS_REGRAS[] =
+    "Livro antigo com anotações sobre Blackwood.\000"
+    "Faca suja com iniciais M.W.\000"
+    "Manchas suspeitas na pia.\000"
+    "Pegadas de lama levando à janela do sótão.\000"
+    "Pegadas de lama no sótão.\000"
+    "Luvas de seda pertencentes à Sra. Green.\000"
+    "Luvas de seda encontradas no jardim.\000";
+
+static const size_t TABELA_INICIO_TEXTOS[7] = {
+    0, 46, 74, 100, 146, 174, 216,
+};
+
+static const uint64_t TABELA_HASHES_TEXTOS[7] = {
+    0x7c7263b26acf0508ULL, 0xa403687969d96f0bULL, 0x671218c59e34ef6fULL, 0xe4df3665808ffefeULL, 0xb4560fda0ed92ee4ULL,
+    0xfe2bd4b462c95908ULL, 0x5326052704063932ULL,
+};
+
+static const uint32_t TABELA_INDICE_TEXTOS[64] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 6,
+    0, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 5, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 3, 0, 0,
+    7, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 4, 0,
+};
+
+static const char* const REGRAS_PADRAO[] = {
+    "pista|Biblioteca|Livro antigo com anotações sobre Blackwood.",
+    "suspeito|Biblioteca|Sr. Blackwood|Livro antigo com anotações sobre Blackwood.",
+    "pista|Cozinha|Faca suja com iniciais M.W.",
+    "suspeito|Cozinha|Mary White|Faca suja com iniciais M.W.",
+    "suspeito|Cozinha|Mary White|Manchas suspeitas na pia.",
+    "pista|Sótão|Pegadas de lama levando à janela do sótão.",
+    "suspeito|Sótão|Empregada|Pegadas de lama no sótão.",
+    "pista|Jardim de Inverno|Luvas de seda pertencentes à Sra. Green.",
+    "suspeito|Jardim de Inverno|Sra. Green|Luvas de seda encontradas no jardim.",
+    NULL
+};
+
+static const AssociacaoRegra TABELA_ASSOCIACOES[5] = {
+    { "Mary White", 1, (AssociacaoRegra*) &TABELA_ASSOCIACOES[1] },
+    { "Mary White", 2, NULL },
+    { "Sr. Blackwood", 0, NULL },
+    { "Sra. Green", 6, NULL },
+    { "Empregada", 4, NULL },
+};
+
+static const RegraSala TABELA_REGRAS[4] = {
+    { 1, (AssociacaoRegra*) &TABELA_ASSOCIACOES[0], (AssociacaoRegra*) &TABELA_ASSOCIACOES[1] },   // Cozinha
+    { 0, (AssociacaoRegra*) &TABELA_ASSOCIACOES[2], (AssociacaoRegra*) &TABELA_ASSOCIACOES[2] },   // Biblioteca
+    { 5, (AssociacaoRegra*) &TABELA_ASSOCIACOES[3], (AssociacaoRegra*) &TABELA_ASSOCIACOES[3] },   // Jardim de Inverno
+    { 3, (AssociacaoRegra*) &TABELA_ASSOCIACOES[4], (AssociacaoRegra*) &TABELA_ASSOCIACOES[4] },   // Sótão
+};
+
+static RegraSala* const TABELA_REGRAS_POR_SALA[7] = {
+    NULL,
+    NULL,
+    (RegraSala*) &TABELA_REGRAS[0],
+    (RegraSala*) &TABELA_REGRAS[1],
+    (RegraSala*) &TABELA_REGRAS[2],
+    (RegraSala*) &TABELA_REGRAS[3],
+    NULL,
+};
+
+#endif
+
+#endif
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "mansao_tabelas.h"
+
 // Desafio Detective Quest
 // Tema 4 - Árvores e Tabela Hash
 // Este código inicial serve como base para o desenvolvimento das estruturas de navegação, pistas e suspeitos.
@@ -11,7 +13,8 @@
 // 🌱 Nível Novato: Mapa da Mansão com Árvore Binária
 //
 // - Crie uma struct Sala com nome, e dois ponteiros: esquerda e direita.
-// - Use funções como criarSala(), conectarSalas() e explorarSalas().
+// - O mapa vem pronto de mansao_tabelas.h (gerado de mansao.txt por gerar_tabelas.c);
+//   explorarSalas() o percorre.
 // - A árvore é fixa: Hall de Entrada, Biblioteca, Cozinha, Sótão etc.
 // - O jogador explora indo à esquerda (e) ou à direita (d).
 // - Finaliza com (s) para sair.
@@ -20,10 +23,14 @@
 
 typedef struct Sala {
     char nome[50];
-    struct Sala* esquerda;
-    struct Sala* direita;
+    const struct Sala* esquerda;
+    const struct Sala* direita;
 } Sala;
 
+// Mapa da mansão: vetor constante montado na compilação (a sala 0 é o hall),
+// sem alocação nem liberação
+static const Sala mansao[MANSAO_TOTAL_SALAS] = { MANSAO_SALAS(mansao) };
+
 
 // 🔍 Nível Aventureiro: Armazenamento de Pistas com Árvore de Busca
 // - Crie uma struct Pista com campo texto (string).
@@ -36,35 +43,16 @@ typedef struct Sala {
 // - A árvore de pistas deve ser exibida quando o jogador quiser revisar evidências.
 //
 
+// Nó da árvore de pistas, balanceada como AVL para que a profundidade
+// continue O(log n) mesmo com pistas inseridas em ordem alfabética.
 typedef struct Pista {
     char texto[120];
+    int altura;
     struct Pista* esquerda;
     struct Pista* direita;
 } Pista;
 
 
-// Função: criarSala()
-// Cria uma sala dinamicamente com nome informado.
-Sala* criarSala(const char* nome) {
-    Sala* nova = (Sala*) malloc(sizeof(Sala));
-    if (!nova) {
-        printf("Erro ao alocar memória para sala!\n");
-        exit(1);
-    }
-    strcpy(nova->nome, nome);
-    nova->esquerda = NULL;
-    nova->direita = NULL;
-    return nova;
-}
-
-// Função: conectarSalas()
-// Conecta uma sala principal a duas outras (esquerda e direita).
-void conectarSalas(Sala* principal, Sala* esquerda, Sala* direita) {
-    if (principal == NULL) return;
-    principal->esquerda = esquerda;
-    principal->direita = direita;
-}
-
 // Função: criarPista()
 // Cria dinamicamente uma nova pista com o texto informado.
 Pista* criarPista(const char* texto) {
@@ -74,48 +62,138 @@ Pista* criarPista(const char* texto) {
         exit(1);
     }
     strcpy(nova->texto, texto);
+    nova->altura = 1;
     nova->esquerda = NULL;
     nova->direita = NULL;
     return nova;
 }
 
+// Função: alturaPista()
+// Retorna a altura de uma subárvore (0 para árvore vazia).
+int alturaPista(Pista* p) {
+    return p == NULL ? 0 : p->altura;
+}
+
+// Função: atualizarAltura()
+// Recalcula a altura de um nó a partir dos filhos.
+void atualizarAltura(Pista* p) {
+    int ae = alturaPista(p->esquerda);
+    int ad = alturaPista(p->direita);
+    p->altura = (ae > ad ? ae : ad) + 1;
+}
+
+// Função: rotacionarDireita() / rotacionarEsquerda()
+// Rotações simples da AVL; retornam a nova raiz da subárvore.
+Pista* rotacionarDireita(Pista* y) {
+    Pista* x = y->esquerda;
+    y->esquerda = x->direita;
+    x->direita = y;
+    atualizarAltura(y);
+    atualizarAltura(x);
+    return x;
+}
+
+Pista* rotacionarEsquerda(Pista* x) {
+    Pista* y = x->direita;
+    x->direita = y->esquerda;
+    y->esquerda = x;
+    atualizarAltura(x);
+    atualizarAltura(y);
+    return y;
+}
+
+// Função: balancearPista()
+// Corrige o fator de balanceamento de um nó com rotação simples ou dupla.
+Pista* balancearPista(Pista* p) {
+    atualizarAltura(p);
+    int fator = alturaPista(p->esquerda) - alturaPista(p->direita);
+
+    if (fator > 1) {
+        if (alturaPista(p->esquerda->esquerda) < alturaPista(p->esquerda->direita))
+            p->esquerda = rotacionarEsquerda(p->esquerda);
+        return rotacionarDireita(p);
+    }
+    if (fator < -1) {
+        if (alturaPista(p->direita->direita) < alturaPista(p->direita->esquerda))
+            p->direita = rotacionarDireita(p->direita);
+        return rotacionarEsquerda(p);
+    }
+    return p;
+}
+
 // ---------------------------------------------------
 // Função: inserirPista()
 // Insere uma pista na árvore de busca (ordem alfabética).
+// A descida é iterativa e guarda o caminho; na volta, cada ancestral
+// é rebalanceado até que a altura da subárvore pare de mudar.
 // ---------------------------------------------------
-Pista* inserirPista(Pista* raiz, const char* texto) {
-    if (raiz == NULL)
-        return criarPista(texto);
-
-    if (strcmp(texto, raiz->texto) < 0)
-        raiz->esquerda = inserirPista(raiz->esquerda, texto);
-    else if (strcmp(texto, raiz->texto) > 0)
-        raiz->direita = inserirPista(raiz->direita, texto);
+#define ALTURA_MAX_AVL 64
 
+Pista* inserirPista(Pista* raiz, const char* texto) {
+    Pista** caminho[ALTURA_MAX_AVL];
+    int n = 0;
+    Pista** link = &raiz;
+
+    while (*link != NULL) {
+        int cmp = strcmp(texto, (*link)->texto);
+        if (cmp == 0)
+            return raiz;
+        caminho[n++] = link;
+        if (cmp < 0)
+            link = &(*link)->esquerda;
+        else
+            link = &(*link)->direita;
+    }
+    *link = criarPista(texto);
+
+    while (n > 0) {
+        Pista** l = caminho[--n];
+        int alturaAntes = (*l)->altura;
+        *l = balancearPista(*l);
+        if ((*l)->altura == alturaAntes)
+            break;
+    }
     return raiz;
 }
 
 // Função: listarPistas()
-// Exibe todas as pistas em ordem alfabética (em ordem).
+// Exibe todas as pistas em ordem alfabética (em ordem), sem recursão: a
+// pilha guarda os nós cuja subárvore esquerda está sendo visitada. Como a
+// árvore é AVL, ALTURA_MAX_AVL posições bastam.
 void listarPistas(Pista* raiz) {
-    if (raiz == NULL) return;
-    listarPistas(raiz->esquerda);
-    printf("🧩 %s\n", raiz->texto);
-    listarPistas(raiz->direita);
+    Pista* pilha[ALTURA_MAX_AVL];
+    int topo = 0;
+    for (Pista* p = raiz; p != NULL || topo > 0; p = p->direita) {
+        for (; p != NULL; p = p->esquerda)
+            pilha[topo++] = p;
+        p = pilha[--topo];
+        printf("🧩 %s\n", p->texto);
+    }
 }
 
 // Função: liberarPistas()
-// Libera memória da árvore de pistas.
+// Libera memória da árvore de pistas sem recursão nem pilha: enquanto o nó
+// tiver filho à esquerda, uma rotação à direita o traz para cima; sem ele, o
+// nó é liberado e o percurso segue pela direita. Cada nó é rotacionado no
+// máximo uma vez, então o custo é O(n).
 void liberarPistas(Pista* raiz) {
-    if (raiz == NULL) return;
-    liberarPistas(raiz->esquerda);
-    liberarPistas(raiz->direita);
-    free(raiz);
+    while (raiz != NULL) {
+        if (raiz->esquerda != NULL) {
+            Pista* esquerda = raiz->esquerda;
+            raiz->esquerda = esquerda->direita;
+            esquerda->direita = raiz;
+            raiz = esquerda;
+        } else {
+            Pista* direita = raiz->direita;
+            free(raiz);
+            raiz = direita;
+        }
+    }
 }
 
 // Função: explorarSalas()
 // Permite explorar a mansão e coletar pistas automaticamente.
-void explorarSalas(Sala* atual, Pista** arvorePistas) {
+void explorarSalas(const Sala* atual, Pista** arvorePistas) {
     char opcao;
 
     while (atual != NULL) {
@@ -169,40 +247,17 @@ void explorarSalas(Sala* atual, Pista** arvorePistas) {
     }
 }
 
-// Função: liberarArvore()
-// Libera memória de todas as salas da mansão.
-void liberarArvore(Sala* raiz) {
-    if (raiz == NULL) return;
-    liberarArvore(raiz->esquerda);
-    liberarArvore(raiz->direita);
-    free(raiz);
-}
-
 // Função: main()
-// Monta o mapa, inicia a exploração e exibe as pistas.
+// Inicia a exploração no hall e exibe as pistas.
 int main() {
 
-    // Criação das salas
-    Sala* hall = criarSala("Hall de Entrada");
-    Sala* salaEstar = criarSala("Sala de Estar");
-    Sala* cozinha = criarSala("Cozinha");
-    Sala* biblioteca = criarSala("Biblioteca");
-    Sala* jardim = criarSala("Jardim de Inverno");
-    Sala* sotao = criarSala("Sótão");
-    Sala* quarto = criarSala("Quarto de Hóspedes");
-
-    // Conexões (estrutura de árvore binária)
-    conectarSalas(hall, salaEstar, cozinha);
-    conectarSalas(salaEstar, biblioteca, jardim);
-    conectarSalas(cozinha, sotao, quarto);
-
     // Árvore de pistas (inicialmente vazia)
     Pista* arvorePistas = NULL;
 
     printf("=== Detective Quest: A Mansão Misteriosa ===\n");
     printf("Explore os cômodos e colete pistas!\n");
 
-    explorarSalas(hall, &arvorePistas);
+    explorarSalas(&mansao[0], &arvorePistas);
 
     printf("\n=== Revisão Final das Pistas ===\n");
     if (arvorePistas == NULL)
@@ -210,7 +265,6 @@ int main() {
     else
         listarPistas(arvorePistas);
 
-    liberarArvore(hall);
     liberarPistas(arvorePistas);
 
     printf("\nMemória liberada. Até a próxima investigação!\n");
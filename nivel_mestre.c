@@ -1,351 +1,4510 @@
+#define _GNU_SOURCE            // memmem
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
 
 // Desafio Detective Quest
 // Tema 4 - Árvores e Tabela Hash
 // Implementação do Nível Mestre: integra mapa (árvore binária),
 // armazenamento de pistas (BST) e relacionamento pista↔suspeito via tabela hash.
+//
+// Compilar: gcc -O2 -pthread nivel_mestre.c -o nivel_mestre
+// (a mansão padrão vem de mansao_tabelas.h, gerado de mansao.txt por gerar_tabelas.c)
 
 // Configurações e tamanhos
 #define MAX_NOME 50
-#define MAX_TEXTO 120
-#define TAM_HASH 13   // número primo simples para reduzir colisões
+#define MAX_LINHA_BUSCA 128
+#define TAM_PAGINA_PISTAS 50  // pistas por página no comando 'l'
+#define TAM_HASH_INICIAL 16   // potência de 2: o índice sai dos bits baixos do hash
+#define CARGA_MAXIMA 0.75     // fator de carga que dispara o crescimento da tabela
+#define PASSO_REHASH 4        // buckets migrados por operação durante um rehash
+
+// Contadores de desempenho nas estruturas (profundidade e comparações na
+// árvore de pistas, nós visitados nas cadeias da hash). Compile com
+// -DESTATISTICAS=0 para removê-los: CONTAR(...) vira vazio e o caminho
+// quente fica idêntico ao sem instrumentação.
+#ifndef ESTATISTICAS
+#define ESTATISTICAS 1
+#endif
+#if ESTATISTICAS
+#define CONTAR(x) (x)
+#else
+#define CONTAR(x) ((void)0)
+#endif
 
 // Estruturas de dados
 
-// Nó da árvore binária que representa uma sala
+// Nó da árvore binária que representa uma sala. As salas ficam num vetor
+// contíguo e se referem umas às outras pelo índice nesse vetor.
+#define SALA_NENHUMA (-1)
+
 typedef struct Sala {
-    char nome[MAX_NOME];
-    struct Sala* esquerda;
-    struct Sala* direita;
+    uint32_t nome;             // deslocamento do nome no bloco de nomes das salas
+    int32_t esquerda;          // índice da sala à esquerda (SALA_NENHUMA se não houver)
+    int32_t direita;
 } Sala;
 
-// Nó da BST que guarda pistas (ordenadas alfabeticamente)
+// Nó da BST balanceada (AVL) que guarda pistas (ordenadas alfabeticamente)
 typedef struct Pista {
-    char texto[MAX_TEXTO];
+    uint64_t prefixo;          // 8 primeiros bytes do texto (prefixoTexto), comparado antes do texto
+    uint32_t pista;            // id do texto no pool de pistas
+    int altura;                // altura da subárvore (balanceamento AVL)
     struct Pista* esquerda;
     struct Pista* direita;
 } Pista;
 
 // Lista encadeada de pistas dentro de um suspeito (associação)
 typedef struct Relacao {
-    char pista[MAX_TEXTO];
+    uint32_t pista;            // id do texto no pool de pistas
     struct Relacao* prox;
 } Relacao;
 
 // Entrada da tabela hash: suspeito com lista de pistas e encadeamento para colisões
 typedef struct Suspeito {
     char nome[MAX_NOME];
+    uint64_t hash;             // hash do nome, guardado para rehash e comparações rápidas
+    uint32_t id;               // ordem de criação (desempate no ranking)
+    int numPistas;             // pistas associadas, mantida a cada inserção
+    size_t posRanking;         // posição do suspeito no heap de ranking
     Relacao* pistas;           // lista de pistas associadas a este suspeito
     struct Suspeito* prox;     // próximo na mesma bucket (encadeamento)
 } Suspeito;
 
-// Tabela hash global
-Suspeito* tabelaHash[TAM_HASH];
+// Índice reverso: lista de suspeitos implicados por uma pista
+typedef struct Implicacao {
+    Suspeito* suspeito;
+    struct Implicacao* prox;
+} Implicacao;
+
+// Tabela hash redimensionável. Ao crescer, a tabela antiga é mantida e seus
+// buckets são migrados aos poucos (PASSO_REHASH por operação), para que
+// nenhuma inserção isolada pague o custo de rehash da tabela inteira.
+typedef struct TabelaHash {
+    Suspeito** buckets;        // tabela atual
+    size_t tamanho;            // número de buckets da tabela atual
+    Suspeito** antiga;         // tabela em migração (NULL se não há rehash em andamento)
+    size_t tamanhoAntiga;
+    size_t proxMigrar;         // próximo bucket da tabela antiga a ser migrado
+    size_t quantidade;         // total de suspeitos nas duas tabelas
+    size_t buscas;             // estatística: buscas feitas nas cadeias
+    size_t nosVisitados;       // estatística: suspeitos comparados nessas buscas
+} TabelaHash;
+
+// Alocação: arenas
+// Pistas, suspeitos, relações e regras são alocados em arenas (blocos grandes
+// divididos sequencialmente), uma por tipo de nó. Os nós de uma investigação
+// ficam contíguos na memória e a investigação inteira é liberada resetando
+// as arenas, sem percorrer árvores e listas nó a nó.
+
+#define TAM_BLOCO_ARENA (64 * 1024)
+#define ALINHAMENTO_ARENA 16
+
+typedef struct BlocoArena {
+    struct BlocoArena* prox;
+    size_t usado;
+    size_t capacidade;
+    char dados[];
+} BlocoArena;
+
+typedef struct Arena {
+    const char* nome;
+    BlocoArena* primeiro;      // lista de blocos (mantidos após reset para reuso)
+    BlocoArena* atual;         // bloco onde ocorre a próxima alocação
+    size_t objetos;            // alocações atendidas desde o último reset
+    size_t bytesUsados;        // bytes entregues desde o último reset
+    size_t bytesReservados;    // soma da capacidade de todos os blocos
+    size_t blocos;             // blocos obtidos com malloc
+} Arena;
+
+// Arena das regras: montada na inicialização e depois só lida, por isso é
+// compartilhada por todas as sessões
+Arena arenaRegras = { .nome = "Regras" };
+
+// Total de chamadas a malloc/calloc feitas pelo programa (todas as threads)
+_Atomic size_t totalMallocs = 0;
+
+BlocoArena* novoBlocoArena(Arena* a, size_t minimo) {
+    size_t cap = minimo > TAM_BLOCO_ARENA ? minimo : TAM_BLOCO_ARENA;
+    BlocoArena* b = (BlocoArena*) malloc(sizeof(BlocoArena) + cap);
+    if (!b) { printf("Erro malloc arena %s\n", a->nome); exit(1); }
+    totalMallocs++;
+    b->prox = NULL;
+    b->usado = 0;
+    b->capacidade = cap;
+    a->bytesReservados += cap;
+    a->blocos++;
+    return b;
+}
+
+// Reserva 'tamanho' bytes na arena; só chama malloc quando os blocos acabam
+void* alocarArena(Arena* a, size_t tamanho) {
+    tamanho = (tamanho + ALINHAMENTO_ARENA - 1) & ~(size_t)(ALINHAMENTO_ARENA - 1);
+    if (a->atual == NULL) {
+        a->primeiro = a->atual = novoBlocoArena(a, tamanho);
+    }
+    while (a->atual->usado + tamanho > a->atual->capacidade) {
+        if (a->atual->prox == NULL) a->atual->prox = novoBlocoArena(a, tamanho);
+        a->atual = a->atual->prox;
+        a->atual->usado = 0;
+    }
+    void* p = a->atual->dados + a->atual->usado;
+    a->atual->usado += tamanho;
+    a->objetos++;
+    a->bytesUsados += tamanho;
+    return p;
+}
+
+// Descarta todos os nós da arena em O(1); os blocos ficam para reuso
+void resetarArena(Arena* a) {
+    a->atual = a->primeiro;
+    if (a->atual) a->atual->usado = 0;
+    a->objetos = 0;
+    a->bytesUsados = 0;
+}
+
+// Devolve todos os blocos da arena ao sistema
+void liberarArena(Arena* a) {
+    BlocoArena* b = a->primeiro;
+    while (b != NULL) {
+        BlocoArena* prox = b->prox;
+        free(b);
+        b = prox;
+    }
+    a->primeiro = a->atual = NULL;
+    a->objetos = a->bytesUsados = a->bytesReservados = a->blocos = 0;
+}
+
+void* realocarOuSair(void* p, size_t tamanho, const char* oque) {
+    p = realloc(p, tamanho);
+    if (!p) { printf("Erro malloc %s\n", oque); exit(1); }
+    totalMallocs++;
+    return p;
+}
+
+// Relógio monotônico em segundos, para as medições de tempo
+double agoraSegundos() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
 
 // Funções auxiliares: Hash
 
-// Função de hash simples: soma ASCII dos caracteres modulo TAM_HASH
-int calcularHash(const char* chave) {
-    int soma = 0;
-    for (int i = 0; chave[i] != '\0'; i++) soma += (unsigned char)chave[i];
-    return soma % TAM_HASH;
+// Mistura final do MurmurHash3: espalha todos os bits de h pelos bits baixos
+uint64_t misturarHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
 }
 
-// Inicializa a tabela com NULLs
-void inicializarHash() {
-    for (int i = 0; i < TAM_HASH; i++) tabelaHash[i] = NULL;
+// Função de hash: FNV-1a de 64 bits seguido da mistura final do MurmurHash3,
+// que espalha bem todos os bits (o índice usa apenas os bits baixos).
+uint64_t calcularHash(const char* chave) {
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; chave[i] != '\0'; i++) {
+        h ^= (unsigned char)chave[i];
+        h *= 1099511628211ULL;
+    }
+    return misturarHash(h);
 }
 
-// Procura um suspeito por nome na tabela hash; retorna ponteiro ou NULL se não achar
-Suspeito* buscarSuspeito(const char* nome) {
-    int idx = calcularHash(nome);
-    Suspeito* cur = tabelaHash[idx];
+// Pool de pistas (textos internados)
+// Cada texto de pista distinto é guardado uma única vez, num bloco contíguo,
+// e identificado por um id compacto. A árvore de pistas, as relações dos
+// suspeitos e as regras guardam só o id: igualdade vira comparação de inteiros.
+// Um pool pode ter uma base somente leitura (o pool das regras, montado na
+// inicialização): os ids da base vêm primeiro e os textos novos da sessão
+// recebem ids a partir de primeiroId, então várias sessões compartilham a
+// base sem travas.
+
+#define ID_PISTA_NENHUMA UINT32_MAX
+
+typedef struct PoolPistas {
+    const struct PoolPistas* base;  // consultado antes deste pool (NULL se não houver)
+    uint32_t primeiroId;       // id do primeiro texto deste pool (= tamanho da base)
+    char* textos;              // textos terminados em '\0', um após o outro
+    size_t usado;
+    size_t capacidade;
+    size_t* inicio;            // deslocamento do texto de cada id em 'textos'
+    uint64_t* hashes;          // hash de cada texto (evita reler strings no índice)
+    uint32_t quantidade;
+    uint32_t capacidadeIds;
+    uint32_t* indice;          // endereçamento aberto: id local+1 de cada texto (0 = vazio)
+    size_t tamanhoIndice;      // potência de 2
+} PoolPistas;
+
+// Pool das regras de coleta: base compartilhada (somente leitura) das sessões
+PoolPistas poolRegras;
+
+void iniciarPool(PoolPistas* pool, const PoolPistas* base) {
+    memset(pool, 0, sizeof(*pool));
+    pool->base = base;
+    pool->primeiroId = base ? base->primeiroId + base->quantidade : 0;
+}
+
+const char* textoPista(const PoolPistas* pool, uint32_t id) {
+    if (id < pool->primeiroId) return textoPista(pool->base, id);
+    return pool->textos + pool->inicio[id - pool->primeiroId];
+}
+
+// Tamanho do texto sem o '\0': os textos são contíguos, então sai da
+// diferença entre o início deste e o do seguinte, sem strlen
+size_t tamanhoPista(const PoolPistas* pool, uint32_t id) {
+    if (id < pool->primeiroId) return tamanhoPista(pool->base, id);
+    uint32_t local = id - pool->primeiroId;
+    size_t fim = local + 1 < pool->quantidade ? pool->inicio[local + 1] : pool->usado;
+    return fim - pool->inicio[local] - 1;
+}
+
+// Impressão digital de ordenação: os 8 primeiros bytes do texto em ordem
+// big-endian, completados com zeros. Comparar dois prefixos como inteiros dá
+// o mesmo resultado que strcmp sobre esses 8 bytes, então a maioria das
+// comparações na árvore termina numa comparação de inteiros.
+uint64_t prefixoTexto(const char* texto) {
+    uint64_t p = 0;
+    int i = 0;
+    for (; i < 8 && texto[i] != '\0'; i++) p = p << 8 | (unsigned char) texto[i];
+    return i ? p << (8 * (8 - i)) : 0;
+}
+
+// Refaz o índice com o dobro do tamanho, usando os hashes guardados
+void crescerIndicePool(PoolPistas* pool) {
+    size_t novoTam = pool->tamanhoIndice ? pool->tamanhoIndice * 2 : 64;
+    uint32_t* novo = (uint32_t*) calloc(novoTam, sizeof(uint32_t));
+    if (!novo) { printf("Erro malloc índice do pool\n"); exit(1); }
+    totalMallocs++;
+    for (uint32_t local = 0; local < pool->quantidade; local++) {
+        size_t i = pool->hashes[local] & (novoTam - 1);
+        while (novo[i] != 0) i = (i + 1) & (novoTam - 1);
+        novo[i] = local + 1;
+    }
+    free(pool->indice);
+    pool->indice = novo;
+    pool->tamanhoIndice = novoTam;
+}
+
+// Procura o texto só neste pool (sem a base); retorna o id ou ID_PISTA_NENHUMA.
+// Em 'vaga' devolve a posição livre do índice onde o texto entraria.
+uint32_t procurarNoPool(const PoolPistas* pool, const char* texto, size_t tam, uint64_t h, size_t* vaga) {
+    if (pool->tamanhoIndice == 0) return ID_PISTA_NENHUMA;
+    size_t mascara = pool->tamanhoIndice - 1;
+    size_t i = h & mascara;
+    while (pool->indice[i] != 0) {
+        uint32_t local = pool->indice[i] - 1;
+        if (pool->hashes[local] == h && tamanhoPista(pool, pool->primeiroId + local) == tam
+            && memcmp(pool->textos + pool->inicio[local], texto, tam) == 0)
+            return pool->primeiroId + local;
+        i = (i + 1) & mascara;
+    }
+    if (vaga) *vaga = i;
+    return ID_PISTA_NENHUMA;
+}
+
+// Procura o texto na base e no pool; se não existir, copia-o para o bloco e cria um id novo
+uint32_t internarPista(PoolPistas* pool, const char* texto) {
+    uint64_t h = calcularHash(texto);
+    size_t tam = strlen(texto);
+    if (pool->base) {
+        uint32_t id = procurarNoPool(pool->base, texto, tam, h, NULL);
+        if (id != ID_PISTA_NENHUMA) return id;
+    }
+    if ((pool->quantidade + 1) * 2 > pool->tamanhoIndice) crescerIndicePool(pool);
+    size_t vaga;
+    uint32_t id = procurarNoPool(pool, texto, tam, h, &vaga);
+    if (id != ID_PISTA_NENHUMA) return id;
+
+    tam++;                     // com o '\0'
+    if (pool->usado + tam > pool->capacidade) {
+        size_t cap = pool->capacidade ? pool->capacidade * 2 : 4096;
+        while (pool->usado + tam > cap) cap *= 2;
+        pool->textos = (char*) realocarOuSair(pool->textos, cap, "textos do pool");
+        pool->capacidade = cap;
+    }
+    if (pool->quantidade == pool->capacidadeIds) {
+        uint32_t cap = pool->capacidadeIds ? pool->capacidadeIds * 2 : 64;
+        pool->inicio = (size_t*) realocarOuSair(pool->inicio, cap * sizeof(size_t), "ids do pool");
+        pool->hashes = (uint64_t*) realocarOuSair(pool->hashes, cap * sizeof(uint64_t), "hashes do pool");
+        pool->capacidadeIds = cap;
+    }
+
+    uint32_t local = pool->quantidade++;
+    memcpy(pool->textos + pool->usado, texto, tam);
+    pool->inicio[local] = pool->usado;
+    pool->hashes[local] = h;
+    pool->usado += tam;
+    pool->indice[vaga] = local + 1;
+    return pool->primeiroId + local;
+}
+
+// Esquece os textos do pool mantendo os vetores alocados
+void limparPool(PoolPistas* pool) {
+    pool->usado = 0;
+    pool->quantidade = 0;
+    if (pool->indice) memset(pool->indice, 0, pool->tamanhoIndice * sizeof(uint32_t));
+}
+
+void liberarPool(PoolPistas* pool) {
+    free(pool->textos);
+    free(pool->inicio);
+    free(pool->hashes);
+    free(pool->indice);
+    iniciarPool(pool, pool->base);
+}
+
+// Saída em bloco
+// As listagens são formatadas num buffer grande e reutilizável e gravadas
+// com write() em blocos de TAM_BUFFER_SAIDA bytes, direto num descritor
+// (stdout ou arquivo), em vez de um printf por linha. Há dois formatos: o
+// texto com emojis do jogo e um formato compacto separado por tabulações:
+//   pista<TAB>texto
+//   suspeito<TAB>nome<TAB>pista     (uma linha por associação)
+// Sem descritor (iniciarSaidaEmMemoria), o buffer começa pequeno e cresce, e
+// quem o criou envia o conteúdo quando puder (o servidor, sem bloquear).
+// Uma escrita que falha marca 'erro' na saída; quem grava arquivos confere.
+
+#define TAM_BUFFER_SAIDA (256 * 1024)
+#define TAM_INICIAL_SAIDA_MEMORIA 4096
+#define FORMATO_TEXTO 0
+#define FORMATO_TSV 1
+
+typedef struct Saida {
+    int fd;                    // -1: só acumula em memória
+    int formato;
+    char* buf;
+    size_t usado;
+    size_t capacidade;
+    int erro;                  // 1: alguma escrita no descritor falhou
+} Saida;
+
+// Formato das listagens, escolhido na linha de comando (--formato)
+int formatoSaida = FORMATO_TEXTO;
+
+void reservarSaida(Saida* s, size_t capacidade) {
+    if (s->capacidade >= capacidade) return;
+    s->buf = (char*) realocarOuSair(s->buf, capacidade, "buffer de saída");
+    s->capacidade = capacidade;
+}
+
+void iniciarSaida(Saida* s, int fd, int formato) {
+    s->fd = fd;
+    s->formato = formato;
+    s->usado = 0;
+    s->erro = 0;
+    reservarSaida(s, TAM_BUFFER_SAIDA);
+}
+
+void iniciarSaidaEmMemoria(Saida* s, int formato) {
+    s->fd = -1;
+    s->formato = formato;
+    s->usado = 0;
+    s->erro = 0;
+    reservarSaida(s, TAM_INICIAL_SAIDA_MEMORIA);
+}
+
+// Grava 'tam' bytes no descritor, tratando escritas parciais; uma falha
+// marca s->erro e descarta o resto (quem gravou confere no fim)
+void gravarNoDescritor(Saida* s, const char* dados, size_t tam) {
+    size_t feito = 0;
+    while (feito < tam && !s->erro) {
+        ssize_t n = write(s->fd, dados + feito, tam - feito);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) s->erro = 1;
+        else feito += (size_t) n;
+    }
+}
+
+// Grava o conteúdo do buffer no descritor
+void descarregarSaida(Saida* s) {
+    if (s->fd < 0) return;     // em memória: o dono envia
+    gravarNoDescritor(s, s->buf, s->usado);
+    s->usado = 0;
+}
+
+void escreverBytes(Saida* s, const char* dados, size_t tam) {
+    if (tam == 0) return;
+    if (s->fd < 0 && s->usado + tam > s->capacidade) {
+        size_t cap = s->capacidade ? s->capacidade * 2 : TAM_INICIAL_SAIDA_MEMORIA;
+        while (s->usado + tam > cap) cap *= 2;
+        reservarSaida(s, cap);
+    }
+    if (s->usado + tam > s->capacidade) {
+        descarregarSaida(s);
+        if (tam > s->capacidade) {      // maior que o buffer: grava direto
+            gravarNoDescritor(s, dados, tam);
+            return;
+        }
+    }
+    memcpy(s->buf + s->usado, dados, tam);
+    s->usado += tam;
+}
+
+void escreverTexto(Saida* s, const char* texto) {
+    escreverBytes(s, texto, strlen(texto));
+}
+
+// printf para a saída, para as mensagens curtas do jogo (até 512 bytes)
+void escreverFormatado(Saida* s, const char* formato, ...) {
+    char linha[512];
+    va_list args;
+    va_start(args, formato);
+    int n = vsnprintf(linha, sizeof(linha), formato, args);
+    va_end(args);
+    if (n < 0) return;
+    escreverBytes(s, linha, (size_t) n < sizeof(linha) ? (size_t) n : sizeof(linha) - 1);
+}
+
+// Campo do formato TSV: tabulações e quebras de linha viram espaço
+void escreverCampo(Saida* s, const char* texto) {
+    const char* p = texto;
+    while (*p) {
+        size_t n = strcspn(p, "\t\r\n");
+        escreverBytes(s, p, n);
+        p += n;
+        if (*p) {
+            escreverBytes(s, " ", 1);
+            p++;
+        }
+    }
+}
+
+void liberarSaida(Saida* s) {
+    free(s->buf);
+    s->buf = NULL;
+    s->usado = s->capacidade = 0;
+}
+
+// Sessão de investigação
+// Todo o estado de uma investigação (posição no mapa, árvore de pistas,
+// tabela de suspeitos, ranking, textos e arenas) fica numa Sessao. O mapa
+// e as regras são globais e somente leitura depois da inicialização, então
+// várias sessões podem rodar em paralelo, cada uma numa thread.
+
+#define TOP_RANKING 3
+
+// Estatísticas da árvore de pistas (atualizadas só com ESTATISTICAS)
+typedef struct EstatPistas {
+    size_t insercoes;          // chamadas a inserirPista
+    size_t comparacoes;        // comparações de texto nas descidas
+    size_t profundidadeTotal;  // soma das profundidades alcançadas
+    int profundidadeMax;
+    int ultimaProfundidade;    // da inserção mais recente
+} EstatPistas;
+
+// Conjunto de relações (suspeito, pista) já registradas na sessão.
+// Endereçamento aberto sobre a chave (id do suspeito + 1) << 32 | id da pista,
+// então a chave 0 marca posição livre. Consultar se um suspeito já tem uma
+// pista custa O(1), e revisitar uma sala não duplica relações.
+typedef struct ConjuntoRelacoes {
+    uint64_t* chaves;
+    size_t tamanho;            // potência de 2
+    size_t quantidade;
+} ConjuntoRelacoes;
+
+uint64_t chaveRelacao(uint32_t suspeito, uint32_t pista) {
+    return ((uint64_t) suspeito + 1) << 32 | pista;
+}
+
+void crescerConjunto(ConjuntoRelacoes* c) {
+    size_t novoTam = c->tamanho ? c->tamanho * 2 : 64;
+    uint64_t* novo = (uint64_t*) calloc(novoTam, sizeof(uint64_t));
+    if (!novo) { printf("Erro malloc conjunto de relações\n"); exit(1); }
+    totalMallocs++;
+    for (size_t i = 0; i < c->tamanho; i++) {
+        if (c->chaves[i] == 0) continue;
+        size_t j = misturarHash(c->chaves[i]) & (novoTam - 1);
+        while (novo[j] != 0) j = (j + 1) & (novoTam - 1);
+        novo[j] = c->chaves[i];
+    }
+    free(c->chaves);
+    c->chaves = novo;
+    c->tamanho = novoTam;
+}
+
+// Insere a chave; retorna 1 se ela é nova e 0 se já estava no conjunto
+int inserirNoConjunto(ConjuntoRelacoes* c, uint64_t chave) {
+    if ((c->quantidade + 1) * 2 > c->tamanho) crescerConjunto(c);
+    size_t mascara = c->tamanho - 1;
+    size_t i = misturarHash(chave) & mascara;
+    while (c->chaves[i] != 0) {
+        if (c->chaves[i] == chave) return 0;
+        i = (i + 1) & mascara;
+    }
+    c->chaves[i] = chave;
+    c->quantidade++;
+    return 1;
+}
+
+// Tira a chave do conjunto; retorna 0 se ela não estava lá. As chaves
+// seguintes do mesmo trecho ocupado voltam uma posição quando a sondagem
+// delas passava pela vaga, então não há marcas de removido.
+int removerDoConjunto(ConjuntoRelacoes* c, uint64_t chave) {
+    if (c->tamanho == 0) return 0;
+    size_t mascara = c->tamanho - 1;
+    size_t i = misturarHash(chave) & mascara;
+    while (c->chaves[i] != chave) {
+        if (c->chaves[i] == 0) return 0;
+        i = (i + 1) & mascara;
+    }
+    size_t vaga = i;
+    for (size_t j = (i + 1) & mascara; c->chaves[j] != 0; j = (j + 1) & mascara) {
+        size_t ideal = misturarHash(c->chaves[j]) & mascara;
+        // a chave de j pode ir para a vaga se 'ideal' não está em (vaga, j]
+        if (((j - ideal) & mascara) >= ((j - vaga) & mascara)) {
+            c->chaves[vaga] = c->chaves[j];
+            vaga = j;
+        }
+    }
+    c->chaves[vaga] = 0;
+    c->quantidade--;
+    return 1;
+}
+
+void limparConjunto(ConjuntoRelacoes* c) {
+    if (c->chaves) memset(c->chaves, 0, c->tamanho * sizeof(uint64_t));
+    c->quantidade = 0;
+}
+
+void liberarConjunto(ConjuntoRelacoes* c) {
+    free(c->chaves);
+    c->chaves = NULL;
+    c->tamanho = c->quantidade = 0;
+}
+
+typedef struct Sessao {
+    int atual;                 // sala do jogador no mapa compartilhado (SALA_NENHUMA: fora)
+    Pista* arvorePistas;       // pistas coletadas (AVL)
+    EstatPistas estatPistas;
+    TabelaHash tabela;         // suspeitos e suas pistas
+    ConjuntoRelacoes relacoes; // pares (suspeito, pista) já registrados
+    uint64_t* vistas;          // bitset de salas da busca em largura no mapa
+    size_t palavrasVistas;
+    int* fila;                 // fila da busca em largura
+    int* paiNaBusca;           // sala de onde cada sala foi descoberta na busca
+    int capacidadeFila;
+    Implicacao** suspeitosPorPista;  // índice reverso, indexado pelo id da pista
+    size_t capacidadePorPista;
+    uint64_t* naArvore;        // bitset: ids de pista presentes na árvore
+    size_t palavrasNaArvore;
+    Suspeito** ranking;        // heap máximo por número de pistas
+    size_t tamanhoRanking;
+    size_t capacidadeRanking;
+    size_t* candidatos;        // fila auxiliar do topSuspeitos, reutilizada
+    size_t capacidadeCandidatos;
+    PoolPistas pool;           // textos da sessão (base: poolRegras)
+    Saida saida;               // buffer reutilizado pelas listagens
+    struct TabelaCompartilhada* compartilhada;  // se não for NULL, recebe também as associações
+    int participante;          // número desta sessão na tabela compartilhada
+    Arena arenaPistas;
+    Arena arenaSuspeitos;
+    Arena arenaRelacoes;
+} Sessao;
+
+// Bitset das pistas presentes na árvore (a busca por trecho filtra por ele)
+void marcarNaArvore(Sessao* sessao, uint32_t pista) {
+    size_t palavra = pista / 64;
+    if (palavra >= sessao->palavrasNaArvore) {
+        size_t n = sessao->palavrasNaArvore ? sessao->palavrasNaArvore : 16;
+        while (n <= palavra) n *= 2;
+        sessao->naArvore = (uint64_t*) realocarOuSair(sessao->naArvore, n * sizeof(uint64_t), "bitset de pistas");
+        memset(sessao->naArvore + sessao->palavrasNaArvore, 0, (n - sessao->palavrasNaArvore) * sizeof(uint64_t));
+        sessao->palavrasNaArvore = n;
+    }
+    sessao->naArvore[palavra] |= 1ULL << (pista % 64);
+}
+
+int pistaNaArvore(const Sessao* sessao, uint32_t pista) {
+    size_t palavra = pista / 64;
+    return palavra < sessao->palavrasNaArvore && (sessao->naArvore[palavra] >> (pista % 64) & 1);
+}
+
+// Funções auxiliares: tabela de suspeitos
+
+Suspeito** alocarBuckets(size_t tamanho) {
+    Suspeito** b = (Suspeito**) calloc(tamanho, sizeof(Suspeito*));
+    if (!b) { printf("Erro malloc tabela hash\n"); exit(1); }
+    totalMallocs++;
+    return b;
+}
+
+// Inicializa a tabela vazia com TAM_HASH_INICIAL buckets
+void inicializarHash(TabelaHash* t) {
+    t->buckets = alocarBuckets(TAM_HASH_INICIAL);
+    t->tamanho = TAM_HASH_INICIAL;
+    t->antiga = NULL;
+    t->tamanhoAntiga = 0;
+    t->proxMigrar = 0;
+    t->quantidade = 0;
+    t->buscas = t->nosVisitados = 0;
+}
+
+// Migra até PASSO_REHASH buckets da tabela antiga para a atual.
+// Usa o hash guardado em cada suspeito, sem reler os nomes.
+void passoRehash(TabelaHash* t) {
+    if (t->antiga == NULL) return;
+    size_t mascara = t->tamanho - 1;
+    for (int passo = 0; passo < PASSO_REHASH && t->proxMigrar < t->tamanhoAntiga; passo++) {
+        Suspeito* s = t->antiga[t->proxMigrar];
+        while (s != NULL) {
+            Suspeito* prox = s->prox;
+            size_t idx = s->hash & mascara;
+            s->prox = t->buckets[idx];
+            t->buckets[idx] = s;
+            s = prox;
+        }
+        t->antiga[t->proxMigrar++] = NULL;
+    }
+    if (t->proxMigrar == t->tamanhoAntiga) {
+        free(t->antiga);
+        t->antiga = NULL;
+        t->tamanhoAntiga = 0;
+        t->proxMigrar = 0;
+    }
+}
+
+// Dobra a tabela quando o fator de carga passa de CARGA_MAXIMA.
+// Se um rehash anterior ainda não terminou, ele é concluído antes.
+void crescerHashSeNecessario(TabelaHash* t) {
+    if (t->quantidade + 1 <= t->tamanho * CARGA_MAXIMA) return;
+    while (t->antiga != NULL) passoRehash(t);
+    t->antiga = t->buckets;
+    t->tamanhoAntiga = t->tamanho;
+    t->proxMigrar = 0;
+    t->tamanho *= 2;
+    t->buckets = alocarBuckets(t->tamanho);
+}
+
+// Procura o suspeito numa cadeia comparando primeiro o hash guardado
+Suspeito* buscarNaCadeia(TabelaHash* t, Suspeito* cur, uint64_t h, const char* nome) {
+    (void) t;
     while (cur != NULL) {
-        if (strcmp(cur->nome, nome) == 0) return cur;
+        CONTAR(t->nosVisitados++);
+        if (cur->hash == h && strcmp(cur->nome, nome) == 0) return cur;
         cur = cur->prox;
     }
     return NULL;
 }
 
+// Procura nas duas tabelas (durante um rehash o suspeito pode estar em qualquer uma)
+Suspeito* buscarComHash(TabelaHash* t, const char* nome, uint64_t h) {
+    CONTAR(t->buscas++);
+    Suspeito* s = buscarNaCadeia(t, t->buckets[h & (t->tamanho - 1)], h, nome);
+    if (s == NULL && t->antiga != NULL) {
+        size_t idx = h & (t->tamanhoAntiga - 1);
+        if (idx >= t->proxMigrar) s = buscarNaCadeia(t, t->antiga[idx], h, nome);
+    }
+    return s;
+}
+
+// Procura um suspeito por nome na tabela hash; retorna ponteiro ou NULL se não achar
+Suspeito* buscarSuspeito(Sessao* sessao, const char* nome) {
+    passoRehash(&sessao->tabela);
+    return buscarComHash(&sessao->tabela, nome, calcularHash(nome));
+}
+
+// Devolve a bucket i da visão combinada: primeiro os buckets ainda não
+// migrados da tabela antiga, depois os da tabela atual.
+size_t totalBuckets(const TabelaHash* t) {
+    return t->tamanhoAntiga + t->tamanho;
+}
+
+Suspeito* bucketCombinada(const TabelaHash* t, size_t i) {
+    if (i < t->tamanhoAntiga)
+        return i >= t->proxMigrar ? t->antiga[i] : NULL;
+    return t->buckets[i - t->tamanhoAntiga];
+}
+
+// Esvazia a tabela mantendo os buckets alocados, para reaproveitá-los
+// na próxima investigação sem novos mallocs
+void limparHash(TabelaHash* t) {
+    free(t->antiga);
+    t->antiga = NULL;
+    t->tamanhoAntiga = t->proxMigrar = 0;
+    memset(t->buckets, 0, t->tamanho * sizeof(Suspeito*));
+    t->quantidade = 0;
+    t->buscas = t->nosVisitados = 0;
+}
+
+// Libera os vetores de buckets; os suspeitos e relações saem com as arenas da sessão
+void liberarHash(TabelaHash* t) {
+    free(t->antiga);
+    free(t->buckets);
+    t->antiga = t->buckets = NULL;
+    t->tamanho = t->tamanhoAntiga = 0;
+    t->proxMigrar = t->quantidade = 0;
+    t->buscas = t->nosVisitados = 0;
+}
+
+// Ranking de suspeitos (heap máximo indexado)
+// Cada suspeito guarda sua contagem de pistas e sua posição no heap. Como a
+// contagem só cresce, cada nova associação faz apenas uma subida no heap:
+// o mais provável está sempre em ranking[0] e o top-k sai em O(k log k).
+
+// a vem antes de b no ranking: mais pistas; no empate, quem apareceu primeiro
+int precedeNoRanking(Suspeito* a, Suspeito* b) {
+    if (a->numPistas != b->numPistas) return a->numPistas > b->numPistas;
+    return a->id < b->id;
+}
+
+// Sobe o suspeito no heap até a posição correta
+void promoverNoRanking(Sessao* sessao, Suspeito* s) {
+    Suspeito** ranking = sessao->ranking;
+    size_t i = s->posRanking;
+    while (i > 0) {
+        size_t pai = (i - 1) / 2;
+        if (!precedeNoRanking(s, ranking[pai])) break;
+        ranking[i] = ranking[pai];
+        ranking[i]->posRanking = i;
+        i = pai;
+    }
+    ranking[i] = s;
+    s->posRanking = i;
+}
+
+void adicionarAoRanking(Sessao* sessao, Suspeito* s) {
+    if (sessao->tamanhoRanking == sessao->capacidadeRanking) {
+        sessao->capacidadeRanking = sessao->capacidadeRanking ? sessao->capacidadeRanking * 2 : 16;
+        sessao->ranking = (Suspeito**) realocarOuSair(sessao->ranking,
+                              sessao->capacidadeRanking * sizeof(Suspeito*), "ranking");
+    }
+    s->posRanking = sessao->tamanhoRanking++;
+    promoverNoRanking(sessao, s);
+}
+
+// Preenche 'saida' com os k suspeitos mais citados, em ordem; retorna quantos.
+// Percorre o heap com uma fila de prioridade auxiliar de candidatos (índices
+// do heap): só os filhos dos já escolhidos podem ser o próximo.
+int topSuspeitos(Sessao* sessao, Suspeito** saida, int k) {
+    Suspeito** ranking = sessao->ranking;
+    if (k <= 0 || sessao->tamanhoRanking == 0) return 0;
+    if (sessao->capacidadeCandidatos < 2 * (size_t)k + 1) {
+        sessao->capacidadeCandidatos = 2 * (size_t)k + 1;
+        sessao->candidatos = (size_t*) realocarOuSair(sessao->candidatos,
+                                 sessao->capacidadeCandidatos * sizeof(size_t), "top-k");
+    }
+    size_t* cand = sessao->candidatos;
+    int nCand = 0, n = 0;
+    cand[nCand++] = 0;
+    while (n < k && nCand > 0) {
+        size_t melhor = cand[0];
+        saida[n++] = ranking[melhor];
+
+        // remove o topo da fila auxiliar
+        size_t ultimo = cand[--nCand];
+        int i = 0;
+        while (nCand > 0) {
+            int f = 2 * i + 1;
+            if (f >= nCand) break;
+            if (f + 1 < nCand && precedeNoRanking(ranking[cand[f + 1]], ranking[cand[f]])) f++;
+            if (!precedeNoRanking(ranking[cand[f]], ranking[ultimo])) break;
+            cand[i] = cand[f];
+            i = f;
+        }
+        if (nCand > 0) cand[i] = ultimo;
+
+        // insere os filhos do escolhido como candidatos
+        for (size_t f = 2 * melhor + 1; f <= 2 * melhor + 2 && f < sessao->tamanhoRanking; f++) {
+            int j = nCand++;
+            while (j > 0 && precedeNoRanking(ranking[f], ranking[cand[(j - 1) / 2]])) {
+                cand[j] = cand[(j - 1) / 2];
+                j = (j - 1) / 2;
+            }
+            cand[j] = f;
+        }
+    }
+    return n;
+}
+
 // Insere um novo suspeito na bucket (sem pistas ainda); retorna ponteiro criado
-Suspeito* criarSuspeito(const char* nome) {
-    Suspeito* s = (Suspeito*) malloc(sizeof(Suspeito));
-    if (!s) { printf("Erro malloc Suspeito\n"); exit(1); }
+Suspeito* criarSuspeito(Sessao* sessao, const char* nome) {
+    Suspeito* s = (Suspeito*) alocarArena(&sessao->arenaSuspeitos, sizeof(Suspeito));
     strncpy(s->nome, nome, MAX_NOME-1);
     s->nome[MAX_NOME-1] = '\0';
+    s->hash = calcularHash(s->nome);
+    s->id = (uint32_t) sessao->tabela.quantidade;
+    s->numPistas = 0;
     s->pistas = NULL;
     s->prox = NULL;
+    adicionarAoRanking(sessao, s);
     return s;
 }
 
-// Adiciona uma pista à lista de um suspeito (insere no início)
-void adicionarRelacaoASuspeito(Suspeito* s, const char* pista) {
+// Garante posição no índice reverso para os ids de pista até 'pista'
+void reservarIndiceReverso(Sessao* sessao, size_t pista) {
+    if (pista < sessao->capacidadePorPista) return;
+    size_t cap = sessao->capacidadePorPista ? sessao->capacidadePorPista : 64;
+    while (cap <= pista) cap *= 2;
+    sessao->suspeitosPorPista = (Implicacao**) realocarOuSair(sessao->suspeitosPorPista,
+                                                             cap * sizeof(Implicacao*), "índice reverso");
+    memset(sessao->suspeitosPorPista + sessao->capacidadePorPista, 0,
+           (cap - sessao->capacidadePorPista) * sizeof(Implicacao*));
+    sessao->capacidadePorPista = cap;
+}
+
+// Adiciona uma pista (id do pool) à lista de um suspeito (insere no início).
+// Uma pista que o suspeito já tem é ignorada.
+void adicionarRelacaoASuspeito(Sessao* sessao, Suspeito* s, uint32_t pista) {
     if (!s) return;
-    Relacao* r = (Relacao*) malloc(sizeof(Relacao));
-    if (!r) { printf("Erro malloc Relacao\n"); exit(1); }
-    strncpy(r->pista, pista, MAX_TEXTO-1);
-    r->pista[MAX_TEXTO-1] = '\0';
+    if (!inserirNoConjunto(&sessao->relacoes, chaveRelacao(s->id, pista))) return;
+    Relacao* r = (Relacao*) alocarArena(&sessao->arenaRelacoes, sizeof(Relacao));
+    r->pista = pista;
     r->prox = s->pistas;
     s->pistas = r;
+    s->numPistas++;
+    promoverNoRanking(sessao, s);
+
+    // mantém o índice reverso pista → suspeitos
+    reservarIndiceReverso(sessao, pista);
+    Implicacao* im = (Implicacao*) alocarArena(&sessao->arenaRelacoes, sizeof(Implicacao));
+    im->suspeito = s;
+    im->prox = sessao->suspeitosPorPista[pista];
+    sessao->suspeitosPorPista[pista] = im;
+}
+
+// Suspeitos implicados por uma pista (id do pool), sem percorrer a tabela
+Implicacao* suspeitosDaPista(const Sessao* sessao, uint32_t pista) {
+    return pista < sessao->capacidadePorPista ? sessao->suspeitosPorPista[pista] : NULL;
 }
 
-// Inserir associação pista ↔ suspeito na tabela hash.
-// Se o suspeito não existir, ele é criado.
-void inserirHash(const char* nomeSuspeito, const char* pista) {
-    int idx = calcularHash(nomeSuspeito);
-    Suspeito* cur = tabelaHash[idx];
+// Inserir associação pista ↔ suspeito na tabela hash, com o hash do nome já
+// calculado (calcularHash). Se o suspeito não existir, ele é criado.
+void inserirHashComHash(Sessao* sessao, const char* nomeSuspeito, uint64_t h, uint32_t pista) {
+    TabelaHash* t = &sessao->tabela;
+    passoRehash(t);
+    Suspeito* cur = buscarComHash(t, nomeSuspeito, h);
 
     // procura suspeito existente
-    while (cur != NULL) {
-        if (strcmp(cur->nome, nomeSuspeito) == 0) {
-            adicionarRelacaoASuspeito(cur, pista);
-            return;
-        }
-        cur = cur->prox;
+    if (cur != NULL) {
+        adicionarRelacaoASuspeito(sessao, cur, pista);
+        return;
     }
 
-    // não encontrou: cria novo suspeito e o insere no início da bucket
-    Suspeito* novo = criarSuspeito(nomeSuspeito);
-    novo->prox = tabelaHash[idx];
-    tabelaHash[idx] = novo;
-    adicionarRelacaoASuspeito(novo, pista);
+    // não encontrou: cria novo suspeito e o insere no início da bucket da tabela atual
+    crescerHashSeNecessario(t);
+    Suspeito* novo = criarSuspeito(sessao, nomeSuspeito);
+    size_t idx = novo->hash & (t->tamanho - 1);
+    novo->prox = t->buckets[idx];
+    t->buckets[idx] = novo;
+    t->quantidade++;
+    adicionarRelacaoASuspeito(sessao, novo, pista);
 }
 
-// Lista todos os suspeitos e suas pistas
-void listarAssociacoes() {
-    printf("\n=== Relação de Suspeitos e Pistas ===\n");
+void inserirHashId(Sessao* sessao, const char* nomeSuspeito, uint32_t pista) {
+    inserirHashComHash(sessao, nomeSuspeito, calcularHash(nomeSuspeito), pista);
+}
+
+void inserirHash(Sessao* sessao, const char* nomeSuspeito, const char* pista) {
+    inserirHashId(sessao, nomeSuspeito, internarPista(&sessao->pool, pista));
+}
+
+// Prepara o buffer da sessão para escrever no stdout, no formato escolhido.
+// O stdio é esvaziado antes para manter a ordem com os printf do jogo.
+Saida* saidaPadrao(Sessao* sessao) {
+    fflush(stdout);
+    iniciarSaida(&sessao->saida, STDOUT_FILENO, formatoSaida);
+    return &sessao->saida;
+}
+
+// Escreve todos os suspeitos e suas pistas na saída
+void escreverAssociacoes(Sessao* sessao, Saida* out) {
+    const TabelaHash* t = &sessao->tabela;
+    int texto = out->formato == FORMATO_TEXTO;
+    if (texto) escreverTexto(out, "\n=== Relação de Suspeitos e Pistas ===\n");
     int contadorTotal = 0;
-    for (int i = 0; i < TAM_HASH; i++) {
-        Suspeito* s = tabelaHash[i];
+    for (size_t i = 0; i < totalBuckets(t); i++) {
+        Suspeito* s = bucketCombinada(t, i);
         while (s != NULL) {
-            printf("\n👤 Suspeito: %s\n", s->nome);
             Relacao* r = s->pistas;
-            if (r == NULL) printf("   (nenhuma pista associada)\n");
+            if (texto) {
+                escreverTexto(out, "\n👤 Suspeito: ");
+                escreverTexto(out, s->nome);
+                escreverTexto(out, r == NULL ? "\n   (nenhuma pista associada)\n" : "\n");
+            } else if (r == NULL) {
+                escreverTexto(out, "suspeito\t");
+                escreverCampo(out, s->nome);
+                escreverTexto(out, "\t\n");
+            }
             while (r != NULL) {
-                printf("   - %s\n", r->pista);
+                const char* pista = textoPista(&sessao->pool, r->pista);
+                if (texto) {
+                    escreverTexto(out, "   - ");
+                    escreverTexto(out, pista);
+                } else {
+                    escreverTexto(out, "suspeito\t");
+                    escreverCampo(out, s->nome);
+                    escreverTexto(out, "\t");
+                    escreverCampo(out, pista);
+                }
+                escreverTexto(out, "\n");
                 r = r->prox;
             }
             s = s->prox;
             contadorTotal++;
         }
     }
-    if (contadorTotal == 0) printf("(Nenhum suspeito registrado ainda)\n");
+    if (contadorTotal == 0 && texto) escreverTexto(out, "(Nenhum suspeito registrado ainda)\n");
 }
 
-// Retorna o nome do suspeito com mais pistas associadas (mostra no stdout também)
-void suspeitoMaisProvavel() {
-    int max = 0;
-    char nomeMax[MAX_NOME] = "Desconhecido";
+// Lista todos os suspeitos e suas pistas
+void listarAssociacoes(Sessao* sessao) {
+    Saida* out = saidaPadrao(sessao);
+    escreverAssociacoes(sessao, out);
+    descarregarSaida(out);
+}
 
-    for (int i = 0; i < TAM_HASH; i++) {
-        Suspeito* s = tabelaHash[i];
-        while (s != NULL) {
-            int cont = 0;
-            Relacao* r = s->pistas;
-            while (r != NULL) {
-                cont++;
-                r = r->prox;
-            }
-            if (cont > max) {
-                max = cont;
-                strncpy(nomeMax, s->nome, MAX_NOME-1);
-                nomeMax[MAX_NOME-1] = '\0';
-            }
-            s = s->prox;
-        }
+// Mostra o suspeito com mais pistas associadas: é o topo do ranking, O(1)
+void suspeitoMaisProvavel(Sessao* sessao) {
+    if (sessao->tamanhoRanking == 0) {
+        printf("\n🕵️ Suspeito mais provável: Desconhecido (0 pistas associadas)\n");
+        return;
     }
+    Suspeito* s = sessao->ranking[0];
+    printf("\n🕵️ Suspeito mais provável: %s (%d pistas associadas)\n", s->nome, s->numPistas);
+}
 
-    printf("\n🕵️ Suspeito mais provável: %s (%d pistas associadas)\n", nomeMax, max);
+// Mostra os k suspeitos mais citados
+void escreverRanking(Sessao* sessao, int k, Saida* out) {
+    escreverTexto(out, "\n=== Ranking de Suspeitos ===\n");
+    Suspeito* top[TOP_RANKING];
+    int n = topSuspeitos(sessao, top, k < TOP_RANKING ? k : TOP_RANKING);
+    if (n == 0) escreverTexto(out, "(Nenhum suspeito registrado ainda)\n");
+    for (int i = 0; i < n; i++) escreverFormatado(out, "%d. %s (%d pistas)\n", i + 1, top[i]->nome, top[i]->numPistas);
 }
 
-// Libera memória das relações de um suspeito
-void liberarRelacoes(Relacao* r) {
-    while (r != NULL) {
-        Relacao* tmp = r;
-        r = r->prox;
-        free(tmp);
+// Funções para salas (árvore)
+// O mapa é um vetor contíguo de nós compactos (12 bytes): os filhos são
+// índices no vetor e os nomes ficam num bloco de texto à parte, então um
+// passeio pelo mapa lê só inteiros. Depois de montado, o mapa é renumerado
+// em largura a partir do hall (ordenarSalasEmLargura): os níveis de cima,
+// visitados por toda sessão, ocupam as primeiras linhas de cache. O índice
+// de uma sala também indexa a tabela de regras de coleta.
+
+Sala* salas = NULL;
+int totalSalas = 0;
+int capacidadeSalas = 0;
+char* nomesSalas = NULL;       // nomes terminados em '\0', um após o outro
+size_t usadoNomesSalas = 0;
+size_t capacidadeNomesSalas = 0;
+int mapaGerado = 0;            // 1: o mapa aponta para as tabelas geradas (não liberadas)
+
+// Portas além de esquerda/direita (quarto campo do arquivo de mapa)
+typedef struct Porta {
+    int origem;
+    int destino;
+} Porta;
+
+Porta* portasExtras = NULL;
+size_t totalPortasExtras = 0;
+size_t capacidadePortasExtras = 0;
+
+const char* nomeSala(int id) {
+    return nomesSalas + salas[id].nome;
+}
+
+void adicionarPorta(int origem, int destino) {
+    if (totalPortasExtras == capacidadePortasExtras) {
+        capacidadePortasExtras = capacidadePortasExtras ? capacidadePortasExtras * 2 : 16;
+        portasExtras = (Porta*) realocarOuSair(portasExtras, capacidadePortasExtras * sizeof(Porta), "portas");
     }
+    portasExtras[totalPortasExtras].origem = origem;
+    portasExtras[totalPortasExtras].destino = destino;
+    totalPortasExtras++;
 }
 
-// Libera toda a tabela hash
-void liberarHash() {
-    for (int i = 0; i < TAM_HASH; i++) {
-        Suspeito* s = tabelaHash[i];
-        while (s != NULL) {
-            Suspeito* tmp = s;
-            s = s->prox;
-            liberarRelacoes(tmp->pistas);
-            free(tmp);
-        }
-        tabelaHash[i] = NULL;
+// Cria uma sala sem saídas e devolve seu índice
+int criarSala(const char* nome) {
+    size_t tam = strnlen(nome, MAX_NOME - 1);
+    if (usadoNomesSalas + tam + 1 > capacidadeNomesSalas) {
+        size_t cap = capacidadeNomesSalas ? capacidadeNomesSalas * 2 : 1024;
+        while (usadoNomesSalas + tam + 1 > cap) cap *= 2;
+        nomesSalas = (char*) realocarOuSair(nomesSalas, cap, "nomes das salas");
+        capacidadeNomesSalas = cap;
+    }
+    if (totalSalas == capacidadeSalas) {
+        capacidadeSalas = capacidadeSalas ? capacidadeSalas * 2 : 16;
+        salas = (Sala*) realocarOuSair(salas, capacidadeSalas * sizeof(Sala), "mapa");
     }
+    Sala* s = &salas[totalSalas];
+    s->nome = (uint32_t) usadoNomesSalas;
+    s->esquerda = s->direita = SALA_NENHUMA;
+    memcpy(nomesSalas + usadoNomesSalas, nome, tam);
+    nomesSalas[usadoNomesSalas + tam] = '\0';
+    usadoNomesSalas += tam + 1;
+    return totalSalas++;
 }
 
-// Funções para salas (árvore)
+// Índice de nomes das salas (endereçamento aberto: índice + 1, 0 = vazio),
+// montado por prepararRotas. Com nomes repetidos, vale a primeira sala.
+int* indiceNomesSalas = NULL;
+size_t tamanhoIndiceNomes = 0;
 
-Sala* criarSala(const char* nome) {
-    Sala* s = (Sala*) malloc(sizeof(Sala));
-    if (!s) { printf("Erro malloc Sala\n"); exit(1); }
-    strncpy(s->nome, nome, MAX_NOME-1);
-    s->nome[MAX_NOME-1] = '\0';
-    s->esquerda = s->direita = NULL;
-    return s;
+void indexarNomesSalas() {
+    free(indiceNomesSalas);
+    tamanhoIndiceNomes = 16;
+    while (tamanhoIndiceNomes < 2 * (size_t) totalSalas) tamanhoIndiceNomes *= 2;
+    indiceNomesSalas = (int*) calloc(tamanhoIndiceNomes, sizeof(int));
+    if (!indiceNomesSalas) { printf("Erro malloc índice de salas\n"); exit(1); }
+    totalMallocs++;
+    size_t mascara = tamanhoIndiceNomes - 1;
+    for (int i = 0; i < totalSalas; i++) {
+        size_t j = calcularHash(nomeSala(i)) & mascara;
+        int repetido = 0;
+        while (indiceNomesSalas[j] != 0 && !repetido) {
+            repetido = strcmp(nomeSala(indiceNomesSalas[j] - 1), nomeSala(i)) == 0;
+            j = (j + 1) & mascara;
+        }
+        if (!repetido) indiceNomesSalas[j] = i + 1;
+    }
 }
 
-void conectarSalas(Sala* principal, Sala* esquerda, Sala* direita) {
-    if (!principal) return;
-    principal->esquerda = esquerda;
-    principal->direita = direita;
+// Procura uma sala pelo nome; SALA_NENHUMA se não achar. Usa o índice de
+// nomes quando ele já foi montado e, antes disso, percorre o vetor.
+int buscarSalaPorNome(const char* nome) {
+    if (indiceNomesSalas != NULL) {
+        size_t mascara = tamanhoIndiceNomes - 1;
+        for (size_t j = calcularHash(nome) & mascara; indiceNomesSalas[j] != 0; j = (j + 1) & mascara)
+            if (strcmp(nomeSala(indiceNomesSalas[j] - 1), nome) == 0) return indiceNomesSalas[j] - 1;
+        return SALA_NENHUMA;
+    }
+    for (int i = 0; i < totalSalas; i++)
+        if (strcmp(nomeSala(i), nome) == 0) return i;
+    return SALA_NENHUMA;
 }
 
-void liberarArvore(Sala* raiz) {
-    if (!raiz) return;
-    liberarArvore(raiz->esquerda);
-    liberarArvore(raiz->direita);
-    free(raiz);
+void conectarSalas(int principal, int esquerda, int direita) {
+    if (principal == SALA_NENHUMA) return;
+    salas[principal].esquerda = esquerda;
+    salas[principal].direita = direita;
 }
 
-// Funções para pistas (BST)
+// Renumera o mapa em largura a partir de 'raiz', que passa a ser a sala 0.
+// Salas inalcançáveis vão para o fim, na ordem original. Os nomes são
+// copiados na mesma ordem. Deve ser chamada antes de carregar as regras.
+void ordenarSalasEmLargura(int raiz) {
+    if (totalSalas == 0) return;
+    int* ordem = (int*) malloc(totalSalas * sizeof(int));     // nova posição → sala antiga
+    int* novoId = (int*) malloc(totalSalas * sizeof(int));    // sala antiga → nova posição
+    Sala* novas = (Sala*) malloc(capacidadeSalas * sizeof(Sala));
+    char* novosNomes = (char*) malloc(capacidadeNomesSalas);
+    if (!ordem || !novoId || !novas || !novosNomes) { printf("Erro malloc mapa\n"); exit(1); }
+    totalMallocs += 4;
 
-Pista* criarPista(const char* texto) {
-    Pista* p = (Pista*) malloc(sizeof(Pista));
-    if (!p) { printf("Erro malloc Pista\n"); exit(1); }
-    strncpy(p->texto, texto, MAX_TEXTO-1);
-    p->texto[MAX_TEXTO-1] = '\0';
-    p->esquerda = p->direita = NULL;
-    return p;
-}
+    for (int i = 0; i < totalSalas; i++) novoId[i] = SALA_NENHUMA;
+    int n = 0, proximaSolta = 0;   // salas antes de proximaSolta já têm posição
+    ordem[n++] = raiz;
+    novoId[raiz] = 0;
+    for (int lido = 0; lido < totalSalas; lido++) {
+        if (lido == n) {   // resto do mapa não é alcançável pela raiz
+            while (novoId[proximaSolta] != SALA_NENHUMA) proximaSolta++;
+            novoId[proximaSolta] = n;
+            ordem[n++] = proximaSolta;
+        }
+        int filhos[2] = { salas[ordem[lido]].esquerda, salas[ordem[lido]].direita };   // portas extras não entram na ordem
+        for (int f = 0; f < 2; f++) {
+            if (filhos[f] != SALA_NENHUMA && novoId[filhos[f]] == SALA_NENHUMA) {
+                novoId[filhos[f]] = n;
+                ordem[n++] = filhos[f];
+            }
+        }
+    }
 
-// Insere texto na BST (ordenado por strcmp); evita duplicatas exatas
-Pista* inserirPista(Pista* raiz, const char* texto) {
-    if (raiz == NULL) return criarPista(texto);
-    int cmp = strcmp(texto, raiz->texto);
-    if (cmp < 0) raiz->esquerda = inserirPista(raiz->esquerda, texto);
-    else if (cmp > 0) raiz->direita = inserirPista(raiz->direita, texto);
-    // se igual, não insere duplicata
-    return raiz;
+    size_t usado = 0;
+    for (int i = 0; i < totalSalas; i++) {
+        const Sala* antiga = &salas[ordem[i]];
+        const char* nome = nomesSalas + antiga->nome;
+        size_t tam = strlen(nome) + 1;
+        memcpy(novosNomes + usado, nome, tam);
+        novas[i].nome = (uint32_t) usado;
+        novas[i].esquerda = antiga->esquerda == SALA_NENHUMA ? SALA_NENHUMA : novoId[antiga->esquerda];
+        novas[i].direita = antiga->direita == SALA_NENHUMA ? SALA_NENHUMA : novoId[antiga->direita];
+        usado += tam;
+    }
+    for (size_t i = 0; i < totalPortasExtras; i++) {
+        portasExtras[i].origem = novoId[portasExtras[i].origem];
+        portasExtras[i].destino = novoId[portasExtras[i].destino];
+    }
+    free(salas);
+    free(nomesSalas);
+    salas = novas;
+    nomesSalas = novosNomes;
+    free(ordem);
+    free(novoId);
 }
 
-void listarPistas(Pista* raiz) {
-    if (!raiz) return;
-    listarPistas(raiz->esquerda);
-    printf("🧩 %s\n", raiz->texto);
-    listarPistas(raiz->direita);
+// Índice de sala num campo do arquivo de mapa: '-' é nenhuma; um valor
+// inválido vira -2, recusado na verificação final
+int lerIndiceSala(const char* campo, int primeira) {
+    if (strcmp(campo, "-") == 0) return SALA_NENHUMA;
+    char* fim;
+    long v = strtol(campo, &fim, 10);
+    if (fim == campo || *fim != '\0' || v < 0 || v > INT32_MAX - primeira) return -2;
+    return primeira + (int) v;
 }
 
-void liberarPistas(Pista* raiz) {
-    if (!raiz) return;
-    liberarPistas(raiz->esquerda);
-    liberarPistas(raiz->direita);
-    free(raiz);
+// Lê o arquivo inteiro com um read() (repetido só se vier incompleto) num
+// buffer terminado em '\0'; retorna NULL se não abrir. O chamador libera.
+char* lerArquivoInteiro(const char* caminho, size_t* lido) {
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat info;
+    if (fstat(fd, &info) != 0) { close(fd); return NULL; }
+    size_t tam = (size_t) info.st_size;
+    char* buf = (char*) malloc(tam + 1);
+    if (!buf) { printf("Erro malloc leitura de %s\n", caminho); exit(1); }
+    totalMallocs++;
+    *lido = 0;
+    while (*lido < tam) {
+        ssize_t n = read(fd, buf + *lido, tam - *lido);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        *lido += (size_t) n;
+    }
+    close(fd);
+    buf[*lido] = '\0';
+    return buf;
 }
 
-// Exploração: integração total
-
-// A função explorarSalas navega pela árvore de salas.
-// Ao entrar em determinadas salas, adiciona pista na BST e associa a suspeitos na hash.
-void explorarSalas(Sala* atual, Pista** arvorePistas) {
-    char opcao;
-    while (atual != NULL) {
-        printf("\nVocê está na: %s\n", atual->nome);
+// Monta o mapa a partir de um texto com uma sala por linha, na forma
+//   <nome>|<esquerda>|<direita>[|<porta>,<porta>,...]
+// onde esquerda, direita e as portas extras (opcionais) são números de sala
+// (a ordem das linhas, a partir de 0); esquerda e direita podem ser '-' para
+// nenhuma. Portas podem formar ciclos. Linhas vazias ou iniciadas por '#' são
+// ignoradas. O texto é interpretado no próprio buffer (que é modificado); o
+// vetor de salas e o bloco de nomes são alocados uma única vez. 'origem'
+// identifica o texto nas mensagens de erro.
+// Retorna 0 se alguma linha for inválida.
+int carregarMapaDeTexto(char* buf, size_t lido, const char* origem) {
+    // reserva tudo de uma vez: no máximo uma sala por linha e nomes <= arquivo
+    size_t linhas = 1;
+    for (char* p = buf; (p = memchr(p, '\n', buf + lido - p)) != NULL; p++) linhas++;
+    if (totalSalas + linhas > (size_t) capacidadeSalas) {
+        capacidadeSalas = totalSalas + (int) linhas;
+        salas = (Sala*) realocarOuSair(salas, capacidadeSalas * sizeof(Sala), "mapa");
+    }
+    if (usadoNomesSalas + lido + 1 > capacidadeNomesSalas) {
+        capacidadeNomesSalas = usadoNomesSalas + lido + 1;
+        nomesSalas = (char*) realocarOuSair(nomesSalas, capacidadeNomesSalas, "nomes das salas");
+    }
 
-        // Regras de coleta: cada sala pode gerar uma pista e associações
-        if (strcmp(atual->nome, "Biblioteca") == 0) {
-            *arvorePistas = inserirPista(*arvorePistas, "Livro antigo com anotações sobre Blackwood.");
-            inserirHash("Sr. Blackwood", "Livro antigo com anotações sobre Blackwood.");
-        }
-        else if (strcmp(atual->nome, "Cozinha") == 0) {
-            *arvorePistas = inserirPista(*arvorePistas, "Faca suja com iniciais M.W.");
-            inserirHash("Mary White", "Faca suja com iniciais M.W.");
-            inserirHash("Mary White", "Manchas suspeitas na pia.");
+    int primeira = totalSalas, numLinha = 0, ok = 1;
+    char* linha = buf;
+    while (ok && linha < buf + lido) {
+        char* fim = strchr(linha, '\n');
+        if (fim) *fim = '\0';
+        numLinha++;
+        linha[strcspn(linha, "\r")] = '\0';
+        if (linha[0] != '\0' && linha[0] != '#') {
+            char* campos[4];
+            int n = 0;
+            char* p = linha;
+            while (n < 4) {
+                campos[n++] = p;
+                p = strchr(p, '|');
+                if (p == NULL) break;
+                *p++ = '\0';
+            }
+            if (n < 3) {
+                printf("Sala inválida na linha %d de %s\n", numLinha, origem);
+                ok = 0;
+                break;
+            }
+            int id = criarSala(campos[0]);
+            salas[id].esquerda = lerIndiceSala(campos[1], primeira);
+            salas[id].direita = lerIndiceSala(campos[2], primeira);
+            for (char* porta = n == 4 ? strtok(campos[3], ",") : NULL; porta; porta = strtok(NULL, ","))
+                adicionarPorta(id, lerIndiceSala(porta, primeira));
         }
-        else if (strcmp(atual->nome, "Sótão") == 0) {
-            *arvorePistas = inserirPista(*arvorePistas, "Pegadas de lama levando à janela do sótão.");
-            inserirHash("Empregada", "Pegadas de lama no sótão.");
+        linha = fim ? fim + 1 : buf + lido;
+    }
+
+    for (int i = primeira; ok && i < totalSalas; i++) {
+        if (salas[i].esquerda < SALA_NENHUMA || salas[i].esquerda >= totalSalas
+            || salas[i].direita < SALA_NENHUMA || salas[i].direita >= totalSalas) {
+            printf("Sala '%s' aponta para uma sala inexistente em %s\n", nomeSala(i), origem);
+            ok = 0;
         }
-        else if (strcmp(atual->nome, "Jardim de Inverno") == 0) {
-            *arvorePistas = inserirPista(*arvorePistas, "Luvas de seda pertencentes à Sra. Green.");
-            inserirHash("Sra. Green", "Luvas de seda encontradas no jardim.");
+    }
+    for (size_t i = 0; ok && i < totalPortasExtras; i++) {
+        if (portasExtras[i].destino < 0 || portasExtras[i].destino >= totalSalas) {
+            printf("Sala '%s' tem uma porta para uma sala inexistente em %s\n",
+                   nomeSala(portasExtras[i].origem), origem);
+            ok = 0;
         }
+    }
+    return ok && totalSalas > primeira;
+}
 
-        // Se for folha, termina
-        if (atual->esquerda == NULL && atual->direita == NULL) {
-            printf("Não há mais saídas. Fim da exploração!\n");
-            return;
-        }
+// Carrega o mapa de um arquivo no formato de carregarMapaDeTexto, lido de uma
+// vez; retorna 0 se o arquivo não puder ser lido ou tiver uma linha inválida
+int carregarMapaDeArquivo(const char* caminho) {
+    size_t lido;
+    char* buf = lerArquivoInteiro(caminho, &lido);
+    if (buf == NULL) return 0;
+    int ok = carregarMapaDeTexto(buf, lido, caminho);
+    free(buf);
+    return ok;
+}
 
-        printf("Deseja ir para (e) esquerda, (d) direita, (p) ver pistas, (h) ver suspeitos ou (s) sair? ");
-        scanf(" %c", &opcao);
+// Grafo de salas
+// Além de esquerda e direita, uma sala pode ter portas extras (mais de duas
+// saídas, corredores que voltam, salas alcançadas por dois caminhos). Todas
+// as portas ficam numa representação CSR montada por montarGrafoSalas: as
+// portas da sala s são destinoPortas[inicioPortas[s] .. inicioPortas[s+1]),
+// começando por esquerda e direita. Buscas no grafo marcam as salas vistas
+// num bitset, então cada sala e cada porta são visitadas uma vez.
 
-        if (opcao == 'e' || opcao == 'E') {
-            if (atual->esquerda != NULL) atual = atual->esquerda;
-            else printf("Não há sala à esquerda!\n");
-        }
-        else if (opcao == 'd' || opcao == 'D') {
-            if (atual->direita != NULL) atual = atual->direita;
-            else printf("Não há sala à direita!\n");
-        }
-        else if (opcao == 'p' || opcao == 'P') {
-            printf("\n=== Pistas Coletadas ===\n");
-            if (*arvorePistas == NULL) printf("(Nenhuma pista encontrada ainda)\n");
-            else listarPistas(*arvorePistas);
-        }
-        else if (opcao == 'h' || opcao == 'H') {
-            listarAssociacoes();
-        }
-        else if (opcao == 's' || opcao == 'S') {
-            printf("Saindo da mansão...\n");
-            return;
-        }
-        else {
-            printf("Opção inválida! Use 'e', 'd', 'p', 'h' ou 's'.\n");
-        }
+int* inicioPortas = NULL;      // totalSalas + 1 posições
+int* destinoPortas = NULL;
+size_t totalPortas = 0;
+
+int grauSala(int s) {
+    return inicioPortas[s + 1] - inicioPortas[s];
+}
+
+void liberarGrafoSalas() {
+    free(inicioPortas);
+    free(destinoPortas);
+    inicioPortas = destinoPortas = NULL;
+    totalPortas = 0;
+}
+
+// Monta o CSR a partir de esquerda/direita e das portas extras (duas passadas:
+// conta o grau de cada sala e depois preenche). Chamar depois de ordenar o mapa.
+void montarGrafoSalas() {
+    liberarGrafoSalas();
+    inicioPortas = (int*) calloc((size_t) totalSalas + 1, sizeof(int));
+    if (!inicioPortas) { printf("Erro malloc grafo de salas\n"); exit(1); }
+    totalMallocs++;
+    for (int s = 0; s < totalSalas; s++)
+        inicioPortas[s + 1] = (salas[s].esquerda != SALA_NENHUMA) + (salas[s].direita != SALA_NENHUMA);
+    for (size_t i = 0; i < totalPortasExtras; i++) inicioPortas[portasExtras[i].origem + 1]++;
+    for (int s = 0; s < totalSalas; s++) inicioPortas[s + 1] += inicioPortas[s];
+    totalPortas = (size_t) inicioPortas[totalSalas];
+
+    destinoPortas = (int*) malloc((totalPortas ? totalPortas : 1) * sizeof(int));
+    int* proxima = (int*) malloc(((size_t) totalSalas + 1) * sizeof(int));
+    if (!destinoPortas || !proxima) { printf("Erro malloc grafo de salas\n"); exit(1); }
+    totalMallocs += 2;
+    memcpy(proxima, inicioPortas, ((size_t) totalSalas + 1) * sizeof(int));
+    for (int s = 0; s < totalSalas; s++) {
+        if (salas[s].esquerda != SALA_NENHUMA) destinoPortas[proxima[s]++] = salas[s].esquerda;
+        if (salas[s].direita != SALA_NENHUMA) destinoPortas[proxima[s]++] = salas[s].direita;
     }
+    for (size_t i = 0; i < totalPortasExtras; i++)
+        destinoPortas[proxima[portasExtras[i].origem]++] = portasExtras[i].destino;
+    free(proxima);
 }
 
-// main: monta tudo e executa
-int main() {
-    // inicializa a hash
-    inicializarHash();
-
-    // Monta mapa da mansão (árvore binária)
-    Sala* hall = criarSala("Hall de Entrada");
-    Sala* salaEstar = criarSala("Sala de Estar");
-    Sala* cozinha = criarSala("Cozinha");
-    Sala* biblioteca = criarSala("Biblioteca");
-    Sala* jardim = criarSala("Jardim de Inverno");
-    Sala* sotao = criarSala("Sótão");
-    Sala* quarto = criarSala("Quarto de Hóspedes");
-
-    conectarSalas(hall, salaEstar, cozinha);
-    conectarSalas(salaEstar, biblioteca, jardim);
-    conectarSalas(cozinha, sotao, quarto);
-
-    // Árvore de pistas (BST) iniciamente vazia
-    Pista* arvorePistas = NULL;
-
-    // Introdução
-    printf("=== Detective Quest: Nível Mestre ===\n");
-    printf("Explore, colete pistas e relacione suspeitos.\n");
-
-    // Exploração (coleta de pistas e associações)
-    explorarSalas(hall, &arvorePistas);
-
-    // Revisão final
-    printf("\n=== Revisão Final das Pistas (ordem alfabética) ===\n");
-    if (arvorePistas == NULL) printf("(Nenhuma pista coletada)\n");
-    else listarPistas(arvorePistas);
+// Garante o bitset e a fila da sessão do tamanho do mapa atual
+void reservarBusca(Sessao* sessao) {
+    size_t palavras = ((size_t) totalSalas + 63) / 64;
+    if (palavras > sessao->palavrasVistas) {
+        sessao->vistas = (uint64_t*) realocarOuSair(sessao->vistas, palavras * sizeof(uint64_t), "bitset de salas");
+        sessao->palavrasVistas = palavras;
+    }
+    if (totalSalas > sessao->capacidadeFila) {
+        sessao->fila = (int*) realocarOuSair(sessao->fila, (size_t) totalSalas * sizeof(int), "fila de salas");
+        sessao->paiNaBusca = (int*) realocarOuSair(sessao->paiNaBusca, (size_t) totalSalas * sizeof(int),
+                                                   "fila de salas");
+        sessao->capacidadeFila = totalSalas;
+    }
+}
+
+// Busca em largura no grafo a partir de 'origem', parando ao descobrir
+// 'destino' (SALA_NENHUMA: percorre tudo). Preenche sessao->fila com as salas
+// descobertas, em ordem de distância, e sessao->paiNaBusca com a sala de onde
+// cada uma foi descoberta; retorna quantas são. O bitset e a fila da sessão
+// são reaproveitados entre buscas.
+int buscarEmLargura(Sessao* sessao, int origem, int destino) {
+    reservarBusca(sessao);
+    size_t palavras = ((size_t) totalSalas + 63) / 64;
+    memset(sessao->vistas, 0, palavras * sizeof(uint64_t));
+
+    int n = 0;
+    sessao->fila[n++] = origem;
+    sessao->paiNaBusca[origem] = SALA_NENHUMA;
+    sessao->vistas[origem / 64] |= 1ULL << (origem % 64);
+    for (int lido = 0; lido < n && origem != destino; lido++) {
+        int s = sessao->fila[lido];
+        for (int p = inicioPortas[s]; p < inicioPortas[s + 1]; p++) {
+            int d = destinoPortas[p];
+            uint64_t bit = 1ULL << (d % 64);
+            if (sessao->vistas[d / 64] & bit) continue;
+            sessao->vistas[d / 64] |= bit;
+            sessao->paiNaBusca[d] = s;
+            sessao->fila[n++] = d;
+            if (d == destino) return n;
+        }
+    }
+    return n;
+}
+
+// Salas alcançáveis a partir de 'origem' (em sessao->fila); retorna quantas são
+int salasAlcancaveis(Sessao* sessao, int origem) {
+    return buscarEmLargura(sessao, origem, SALA_NENHUMA);
+}
+
+// Rota mais curta, em portas, de 'origem' até 'destino' seguindo as portas do
+// grafo: escreve as salas (inclusive as duas pontas) em sessao->fila e
+// retorna quantas são, ou 0 se o destino não for alcançável
+int rotaEntreSalas(Sessao* sessao, int origem, int destino) {
+    buscarEmLargura(sessao, origem, destino);
+    if (!(sessao->vistas[destino / 64] >> (destino % 64) & 1)) return 0;
+    int n = 0;
+    for (int s = destino; s != SALA_NENHUMA; s = sessao->paiNaBusca[s]) n++;
+    int pos = n;
+    for (int s = destino; s != SALA_NENHUMA; s = sessao->paiNaBusca[s]) sessao->fila[--pos] = s;
+    return n;
+}
+
+// Rotas no mapa
+// Pré-processamento feito uma vez sobre o mapa montado (prepararRotas):
+//   - pai e profundidade de cada sala;
+//   - passeio de Euler a partir do hall (cada sala aparece ao entrar e ao
+//     voltar de cada filho) e a primeira posição de cada sala nele;
+//   - mínimo de profundidade por bloco de TAM_BLOCO_LCA posições do passeio e
+//     uma tabela esparsa sobre esses mínimos.
+// O ancestral comum de a e b é a sala mais rasa do passeio entre as primeiras
+// posições das duas: dois pedaços de bloco varridos (no máximo 2 × TAM_BLOCO_LCA
+// posições) e uma consulta O(1) na tabela esparsa. Distância na árvore sai da
+// fórmula prof(a) + prof(b) - 2·prof(lca). Essas consultas são só sobre a
+// árvore esquerda/direita: a navegação (n) desce por ela quando o destino
+// está abaixo da sala atual e, senão, busca a rota nas portas do grafo
+// (rotaEntreSalas); a distância na planta (m) vem direto de distanciaSalas.
+// A memória é O(n), mesmo em mapas com milhões de salas.
+
+#define TAM_BLOCO_LCA 32
+
+int* paiSala = NULL;
+int* profundidadeSala = NULL;
+int* primeiraNoPasseio = NULL;    // -1: sala inalcançável a partir do hall
+int* passeioEuler = NULL;
+int* profundidadeNoPasseio = NULL; // profundidade de cada posição (varredura contígua)
+int tamanhoPasseio = 0;
+int* minimoDoBloco = NULL;        // por bloco: posição de menor profundidade
+int* tabelaEsparsa = NULL;        // nível k, bloco j: melhor posição em 2^k blocos
+int niveisEsparsa = 0;
+int blocosPasseio = 0;
+
+// Das duas posições do passeio, a de sala mais rasa
+int maisRasa(int i, int j) {
+    return profundidadeNoPasseio[i] <= profundidadeNoPasseio[j] ? i : j;
+}
+
+int* alocarInteiros(size_t n) {
+    int* v = (int*) malloc((n ? n : 1) * sizeof(int));
+    if (!v) { printf("Erro malloc rotas\n"); exit(1); }
+    totalMallocs++;
+    return v;
+}
+
+void liberarRotas() {
+    free(paiSala);
+    free(profundidadeSala);
+    free(primeiraNoPasseio);
+    free(passeioEuler);
+    free(profundidadeNoPasseio);
+    free(minimoDoBloco);
+    free(tabelaEsparsa);
+    paiSala = profundidadeSala = primeiraNoPasseio = passeioEuler = profundidadeNoPasseio = NULL;
+    minimoDoBloco = tabelaEsparsa = NULL;
+    tamanhoPasseio = niveisEsparsa = blocosPasseio = 0;
+}
+
+void prepararRotas(int raiz) {
+    liberarRotas();
+    indexarNomesSalas();
+    if (totalSalas == 0) return;
+    paiSala = alocarInteiros(totalSalas);
+    profundidadeSala = alocarInteiros(totalSalas);
+    primeiraNoPasseio = alocarInteiros(totalSalas);
+    passeioEuler = alocarInteiros(2 * (size_t) totalSalas);
+    for (int i = 0; i < totalSalas; i++) {
+        paiSala[i] = SALA_NENHUMA;
+        primeiraNoPasseio[i] = -1;
+    }
+
+    // Passeio de Euler iterativo: 'filhoVisitado' guarda quantos filhos da
+    // sala já foram percorridos (0, 1 ou 2), então a pilha é só o caminho atual
+    unsigned char* filhoVisitado = (unsigned char*) calloc(totalSalas, 1);
+    if (!filhoVisitado) { printf("Erro malloc rotas\n"); exit(1); }
+    totalMallocs++;
+    int s = raiz;
+    profundidadeSala[raiz] = 0;
+    primeiraNoPasseio[raiz] = 0;
+    passeioEuler[tamanhoPasseio++] = raiz;
+    while (s != SALA_NENHUMA) {
+        int proximo = SALA_NENHUMA;
+        while (filhoVisitado[s] < 2 && proximo == SALA_NENHUMA) {
+            int f = filhoVisitado[s]++ == 0 ? salas[s].esquerda : salas[s].direita;
+            if (f != SALA_NENHUMA && primeiraNoPasseio[f] < 0) proximo = f;
+        }
+        if (proximo != SALA_NENHUMA) {
+            paiSala[proximo] = s;
+            profundidadeSala[proximo] = profundidadeSala[s] + 1;
+            primeiraNoPasseio[proximo] = tamanhoPasseio;
+            s = proximo;
+        } else {
+            s = paiSala[s];
+        }
+        if (s != SALA_NENHUMA) passeioEuler[tamanhoPasseio++] = s;
+    }
+    free(filhoVisitado);
+    profundidadeNoPasseio = alocarInteiros(tamanhoPasseio);
+    for (int i = 0; i < tamanhoPasseio; i++) profundidadeNoPasseio[i] = profundidadeSala[passeioEuler[i]];
+
+    // Mínimos por bloco e tabela esparsa sobre eles
+    blocosPasseio = (tamanhoPasseio + TAM_BLOCO_LCA - 1) / TAM_BLOCO_LCA;
+    minimoDoBloco = alocarInteiros(blocosPasseio);
+    for (int b = 0; b < blocosPasseio; b++) {
+        int ini = b * TAM_BLOCO_LCA;
+        int fim = ini + TAM_BLOCO_LCA < tamanhoPasseio ? ini + TAM_BLOCO_LCA : tamanhoPasseio;
+        int melhor = ini;
+        for (int i = ini + 1; i < fim; i++) melhor = maisRasa(melhor, i);
+        minimoDoBloco[b] = melhor;
+    }
+    niveisEsparsa = 1;
+    while ((1 << niveisEsparsa) <= blocosPasseio) niveisEsparsa++;
+    tabelaEsparsa = alocarInteiros((size_t) niveisEsparsa * blocosPasseio);
+    memcpy(tabelaEsparsa, minimoDoBloco, blocosPasseio * sizeof(int));
+    for (int k = 1; k < niveisEsparsa; k++) {
+        int* nivel = tabelaEsparsa + (size_t) k * blocosPasseio;
+        int* anterior = nivel - blocosPasseio;
+        for (int j = 0; j + (1 << k) <= blocosPasseio; j++)
+            nivel[j] = maisRasa(anterior[j], anterior[j + (1 << (k - 1))]);
+    }
+}
+
+// Posição mais rasa do passeio no intervalo [i, j] de blocos inteiros
+int maisRasaEntreBlocos(int bi, int bj) {
+    int k = 31 - __builtin_clz((unsigned) (bj - bi + 1));
+    const int* nivel = tabelaEsparsa + (size_t) k * blocosPasseio;
+    return maisRasa(nivel[bi], nivel[bj - (1 << k) + 1]);
+}
+
+// Ancestral comum mais próximo de duas salas; SALA_NENHUMA se alguma delas
+// não for alcançável a partir do hall
+int ancestralComum(int a, int b) {
+    if (primeiraNoPasseio == NULL || primeiraNoPasseio[a] < 0 || primeiraNoPasseio[b] < 0) return SALA_NENHUMA;
+    int i = primeiraNoPasseio[a], j = primeiraNoPasseio[b];
+    if (i > j) { int t = i; i = j; j = t; }
+    int bi = i / TAM_BLOCO_LCA, bj = j / TAM_BLOCO_LCA;
+    int melhor = i;
+    if (bi == bj) {
+        for (int p = i + 1; p <= j; p++) melhor = maisRasa(melhor, p);
+    } else {
+        for (int p = i + 1; p < (bi + 1) * TAM_BLOCO_LCA; p++) melhor = maisRasa(melhor, p);
+        for (int p = bj * TAM_BLOCO_LCA; p <= j; p++) melhor = maisRasa(melhor, p);
+        if (bj - bi > 1) melhor = maisRasa(melhor, maisRasaEntreBlocos(bi + 1, bj - 1));
+    }
+    return passeioEuler[melhor];
+}
+
+// Distância entre duas salas na árvore (arestas até o ancestral comum e de
+// volta); -1 se alguma não for alcançável a partir do hall
+int distanciaSalas(int a, int b) {
+    int lca = ancestralComum(a, b);
+    if (lca == SALA_NENHUMA) return -1;
+    return profundidadeSala[a] + profundidadeSala[b] - 2 * profundidadeSala[lca];
+}
+
+// Rota descendo pela árvore quando 'destino' fica na subárvore de 'origem'
+// (o ancestral comum das duas é a própria origem): as salas saem de paiSala,
+// subindo do destino, em O(profundidade) e sem busca. Escreve a rota em
+// sessao->fila como rotaEntreSalas; retorna 0 se o destino não estiver abaixo.
+int rotaPelaArvore(Sessao* sessao, int origem, int destino) {
+    if (ancestralComum(origem, destino) != origem) return 0;
+    reservarBusca(sessao);
+    int n = profundidadeSala[destino] - profundidadeSala[origem] + 1;
+    int pos = n;
+    for (int s = destino; pos > 0; s = paiSala[s]) sessao->fila[--pos] = s;
+    return n;
+}
+
+// Cursor de salas
+// Percurso em ordem (esquerda, sala, direita) da árvore montada por
+// prepararRotas, sem pilha nem recursão: a posição do cursor é o próprio id
+// da sala e o sucessor sai de paiSala. Posicionar por nome é buscarSalaPorNome.
+// Só contam os filhos da árvore: uma sala alcançada por duas portas aparece
+// uma vez, e portas extras ficam de fora.
+int filhoNaArvore(int s, int f) {
+    return f != SALA_NENHUMA && paiSala[f] == s ? f : SALA_NENHUMA;
+}
+
+int filhoDireitoNaArvore(int s) {
+    int f = filhoNaArvore(s, salas[s].direita);
+    return f != salas[s].esquerda ? f : SALA_NENHUMA;
+}
+
+int salaMaisAEsquerda(int s) {
+    for (int f; (f = filhoNaArvore(s, salas[s].esquerda)) != SALA_NENHUMA; ) s = f;
+    return s;
+}
+
+// Primeira sala em ordem da subárvore de 'raiz'
+int primeiraSalaEmOrdem(int raiz) {
+    return raiz == SALA_NENHUMA || paiSala == NULL ? SALA_NENHUMA : salaMaisAEsquerda(raiz);
+}
+
+// Sala seguinte em ordem, ou SALA_NENHUMA no fim: desce à subárvore direita
+// ou sobe enquanto vier da direita. O(1) amortizado por passo.
+int proximaSalaEmOrdem(int s) {
+    int d = filhoDireitoNaArvore(s);
+    if (d != SALA_NENHUMA) return salaMaisAEsquerda(d);
+    int pai = paiSala[s];
+    while (pai != SALA_NENHUMA && filhoDireitoNaArvore(pai) == s) {
+        s = pai;
+        pai = paiSala[s];
+    }
+    return pai;
+}
+
+// Esquece o mapa gerado sem liberá-lo: as tabelas fazem parte do binário
+void soltarMapaGerado() {
+    salas = NULL;
+    nomesSalas = NULL;
+    indiceNomesSalas = NULL;
+    inicioPortas = destinoPortas = NULL;
+    paiSala = profundidadeSala = primeiraNoPasseio = passeioEuler = profundidadeNoPasseio = NULL;
+    minimoDoBloco = tabelaEsparsa = NULL;
+    mapaGerado = 0;
+}
+
+void liberarSalas() {
+    if (mapaGerado) soltarMapaGerado();
+    liberarRotas();
+    liberarGrafoSalas();
+    free(portasExtras);
+    portasExtras = NULL;
+    totalPortasExtras = capacidadePortasExtras = 0;
+    free(indiceNomesSalas);
+    indiceNomesSalas = NULL;
+    tamanhoIndiceNomes = 0;
+    free(salas);
+    free(nomesSalas);
+    salas = NULL;
+    nomesSalas = NULL;
+    totalSalas = capacidadeSalas = 0;
+    usadoNomesSalas = capacidadeNomesSalas = 0;
+}
+
+// Funções para pistas (árvore AVL)
+// A BST de pistas é balanceada (AVL) para manter profundidade O(log n)
+// mesmo quando as pistas chegam em ordem alfabética. Inserção e busca são
+// iterativas, então a pilha de chamadas não cresce com a árvore.
+
+#define ALTURA_MAX_AVL 64  // uma AVL de altura 64 teria mais de 10^13 nós
+
+Pista* criarPista(Sessao* sessao, uint32_t pista) {
+    Pista* p = (Pista*) alocarArena(&sessao->arenaPistas, sizeof(Pista));
+    p->prefixo = prefixoTexto(textoPista(&sessao->pool, pista));
+    p->pista = pista;
+    p->esquerda = p->direita = NULL;
+    p->altura = 1;
+    marcarNaArvore(sessao, pista);
+    return p;
+}
+
+int alturaPista(Pista* p) {
+    return p ? p->altura : 0;
+}
+
+void atualizarAltura(Pista* p) {
+    int ae = alturaPista(p->esquerda), ad = alturaPista(p->direita);
+    p->altura = (ae > ad ? ae : ad) + 1;
+}
+
+Pista* rotacionarDireita(Pista* y) {
+    Pista* x = y->esquerda;
+    y->esquerda = x->direita;
+    x->direita = y;
+    atualizarAltura(y);
+    atualizarAltura(x);
+    return x;
+}
+
+Pista* rotacionarEsquerda(Pista* x) {
+    Pista* y = x->direita;
+    x->direita = y->esquerda;
+    y->esquerda = x;
+    atualizarAltura(x);
+    atualizarAltura(y);
+    return y;
+}
+
+// Restaura o balanceamento de um nó após inserção em uma de suas subárvores
+Pista* balancearPista(Pista* p) {
+    atualizarAltura(p);
+    int fator = alturaPista(p->esquerda) - alturaPista(p->direita);
+    if (fator > 1) {
+        if (alturaPista(p->esquerda->esquerda) < alturaPista(p->esquerda->direita))
+            p->esquerda = rotacionarEsquerda(p->esquerda);
+        return rotacionarDireita(p);
+    }
+    if (fator < -1) {
+        if (alturaPista(p->direita->direita) < alturaPista(p->direita->esquerda))
+            p->direita = rotacionarDireita(p->direita);
+        return rotacionarEsquerda(p);
+    }
+    return p;
+}
+
+// Compara uma chave (texto, tamanho e prefixo já calculados) com o texto de
+// um nó. Prefixos diferentes decidem sem tocar no pool; iguais com a chave
+// menor que 8 bytes significam textos iguais; senão o memcmp começa no byte 8
+// e inclui o '\0' do mais curto, que desempata como no strcmp.
+static inline int compararComPista(const PoolPistas* pool, uint64_t prefixo,
+                                   const char* texto, size_t tam, const Pista* no) {
+    if (prefixo != no->prefixo) return prefixo < no->prefixo ? -1 : 1;
+    if (tam < 8) return 0;
+    size_t tamNo = tamanhoPista(pool, no->pista);
+    size_t menor = tam < tamNo ? tam : tamNo;
+    return memcmp(texto + 8, textoPista(pool, no->pista) + 8, menor - 8 + 1);
+}
+
+// Insere a pista (id do pool) na AVL, em ordem alfabética; evita duplicatas.
+// Desce guardando o caminho e depois sobe rebalanceando até a altura parar de mudar.
+Pista* inserirPistaId(Sessao* sessao, Pista* raiz, uint32_t pista) {
+    Pista** caminho[ALTURA_MAX_AVL];
+    int n = 0;
+    Pista** link = &raiz;
+    const char* texto = textoPista(&sessao->pool, pista);
+    size_t tam = tamanhoPista(&sessao->pool, pista);
+    uint64_t prefixo = prefixoTexto(texto);
+    CONTAR(sessao->estatPistas.insercoes++);
+    while (*link != NULL) {
+        if ((*link)->pista == pista) break;   // mesmo id: duplicata
+        CONTAR(sessao->estatPistas.comparacoes++);
+        int cmp = compararComPista(&sessao->pool, prefixo, texto, tam, *link);
+        caminho[n++] = link;
+        link = cmp < 0 ? &(*link)->esquerda : &(*link)->direita;
+    }
+#if ESTATISTICAS
+    EstatPistas* e = &sessao->estatPistas;
+    e->ultimaProfundidade = n;
+    e->profundidadeTotal += n;
+    if (n > e->profundidadeMax) e->profundidadeMax = n;
+#endif
+    if (*link != NULL) return raiz;
+    *link = criarPista(sessao, pista);
+
+    while (n > 0) {
+        Pista** l = caminho[--n];
+        int alturaAntes = (*l)->altura;
+        *l = balancearPista(*l);
+        if ((*l)->altura == alturaAntes) break;   // ancestrais não mudam de altura
+    }
+    return raiz;
+}
+
+Pista* inserirPista(Sessao* sessao, Pista* raiz, const char* texto) {
+    return inserirPistaId(sessao, raiz, internarPista(&sessao->pool, texto));
+}
+
+// Busca iterativa de uma pista; retorna o nó ou NULL
+Pista* buscarPista(Sessao* sessao, Pista* raiz, const char* texto) {
+    size_t tam = strlen(texto);
+    uint64_t prefixo = prefixoTexto(texto);
+    while (raiz != NULL) {
+        int cmp = compararComPista(&sessao->pool, prefixo, texto, tam, raiz);
+        if (cmp == 0) return raiz;
+        raiz = cmp < 0 ? raiz->esquerda : raiz->direita;
+    }
+    return NULL;
+}
+
+// Cursor de pistas
+// Percurso em ordem sem recursão: a pilha guarda os nós cuja subárvore
+// esquerda já foi (ou está sendo) visitada, e o topo é a pista atual. A
+// árvore é AVL, então ALTURA_MAX_AVL posições bastam. Posicionar custa
+// O(log n) e cada avanço O(1) amortizado; o chamador para quando quiser.
+// Inserir na árvore invalida os cursores abertos sobre ela.
+typedef struct CursorPistas {
+    Pista* pilha[ALTURA_MAX_AVL];
+    int topo;
+} CursorPistas;
+
+static inline void descerCursorPistas(CursorPistas* c, Pista* p) {
+    for (; p != NULL; p = p->esquerda) c->pilha[c->topo++] = p;
+}
+
+// Posiciona na primeira pista da árvore
+void iniciarCursorPistas(CursorPistas* c, Pista* raiz) {
+    c->topo = 0;
+    descerCursorPistas(c, raiz);
+}
+
+// Posiciona na primeira pista >= texto (os nós onde se desce à esquerda
+// ficam na pilha)
+void buscarCursorPistas(CursorPistas* c, Sessao* sessao, Pista* raiz, const char* texto) {
+    size_t tam = strlen(texto);
+    uint64_t prefixo = prefixoTexto(texto);
+    c->topo = 0;
+    while (raiz != NULL) {
+        if (compararComPista(&sessao->pool, prefixo, texto, tam, raiz) <= 0) {
+            c->pilha[c->topo++] = raiz;
+            raiz = raiz->esquerda;
+        } else {
+            raiz = raiz->direita;
+        }
+    }
+}
+
+// Pista atual, ou NULL quando o percurso acabou
+static inline Pista* pistaDoCursor(const CursorPistas* c) {
+    return c->topo > 0 ? c->pilha[c->topo - 1] : NULL;
+}
+
+void avancarCursorPistas(CursorPistas* c) {
+    Pista* p = c->pilha[--c->topo];
+    descerCursorPistas(c, p->direita);
+}
+
+// Carga em lote de pistas
+// importarPistas recebe um vetor de textos e os coloca na árvore sem passar
+// por inserirPistaId: interna cada texto (textos iguais viram o mesmo id),
+// descarta pelo bitset naArvore os que já estão na árvore ou repetidos no
+// lote, ordena só os novos (em várias threads se o lote for grande),
+// intercala com os nós da árvore atual em ordem e religa tudo numa árvore
+// perfeitamente balanceada. Tirando a ordenação, tudo é O(n), sem rotações.
+#define LOTE_PARALELO_PISTAS 65536  // a partir daqui a ordenação usa threads
+#define MAX_THREADS_LOTE 8
+#define LOTE_INSERCAO 16            // trechos menores são ordenados por inserção
+
+// Chave de ordenação: palavra de 8 bytes do texto e ponteiro para o texto
+// juntos, então a ordenação não passa pelo nó nem pelo índice do pool.
+// Fora de ordenarPorPalavras, 'prefixo' é sempre o prefixoTexto do texto.
+typedef struct ChavePista {
+    uint64_t prefixo;
+    const char* texto;
+    Pista* no;
+} ChavePista;
+
+// Compara chaves cujos textos coincidem nos primeiros 8*nivel bytes e cujo
+// 'prefixo' guarda a palavra do nível. Palavras iguais terminadas em zero
+// são textos que acabam nessa palavra, logo iguais.
+static inline int compararChaves(const ChavePista* a, const ChavePista* b, size_t nivel) {
+    if (a->prefixo != b->prefixo) return a->prefixo < b->prefixo ? -1 : 1;
+    if ((a->prefixo & 0xff) == 0) return 0;
+    return strcmp(a->texto + 8 * (nivel + 1), b->texto + 8 * (nivel + 1));
+}
+
+static inline void trocarChaves(ChavePista* v, size_t i, size_t j) {
+    ChavePista t = v[i];
+    v[i] = v[j];
+    v[j] = t;
+}
+
+static inline uint64_t medianaDeTres(uint64_t a, uint64_t b, uint64_t c) {
+    if (a > b) { uint64_t t = a; a = b; b = t; }
+    return c < a ? a : c > b ? b : c;
+}
+
+// Quicksort de três vias sobre palavras de 8 bytes (multikey quicksort):
+// particiona pela palavra do nível e só o grupo igual ao pivô desce ao
+// nível seguinte, recarregando a palavra. Textos com prefixo comum longo
+// custam uma passada por palavra, não um strcmp do início a cada comparação.
+void ordenarPorPalavras(ChavePista* v, size_t n, size_t nivel) {
+    while (n > LOTE_INSERCAO) {
+        uint64_t pivo = medianaDeTres(v[0].prefixo, v[n / 2].prefixo, v[n - 1].prefixo);
+        size_t menores = 0, i = 0, maiores = n;
+        while (i < maiores) {
+            if (v[i].prefixo < pivo) trocarChaves(v, menores++, i++);
+            else if (v[i].prefixo > pivo) trocarChaves(v, i, --maiores);
+            else i++;
+        }
+        // [menores, maiores) têm a palavra do pivô: seguem pela próxima palavra
+        if ((pivo & 0xff) != 0 && maiores - menores > 1) {
+            for (size_t j = menores; j < maiores; j++)
+                v[j].prefixo = prefixoTexto(v[j].texto + 8 * (nivel + 1));
+            ordenarPorPalavras(v + menores, maiores - menores, nivel + 1);
+            for (size_t j = menores; j < maiores; j++) v[j].prefixo = pivo;
+        }
+        // recursão no lado menor e laço no maior: pilha O(log n) por nível
+        if (menores < n - maiores) {
+            ordenarPorPalavras(v, menores, nivel);
+            v += maiores;
+            n -= maiores;
+        } else {
+            ordenarPorPalavras(v + maiores, n - maiores, nivel);
+            n = menores;
+        }
+    }
+    for (size_t i = 1; i < n; i++) {
+        ChavePista c = v[i];
+        size_t j = i;
+        for (; j > 0 && compararChaves(&c, &v[j - 1], nivel) < 0; j--) v[j] = v[j - 1];
+        v[j] = c;
+    }
+}
+
+// Intercala dois trechos ordenados e disjuntos de chaves em 'destino'
+void intercalarChaves(const ChavePista* a, size_t na, const ChavePista* b, size_t nb, ChavePista* destino) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb)
+        destino[k++] = compararChaves(&b[j], &a[i], 0) < 0 ? b[j++] : a[i++];
+    while (i < na) destino[k++] = a[i++];
+    while (j < nb) destino[k++] = b[j++];
+}
+
+// Trecho de trabalho de uma thread: ordena [inicio, fim) de 'chaves' ou, se
+// 'meio' != 0, intercala [inicio, meio) com [meio, fim) de 'chaves' em 'destino'
+typedef struct TrechoLote {
+    pthread_t thread;
+    ChavePista* chaves;
+    ChavePista* destino;
+    size_t inicio, meio, fim;
+} TrechoLote;
+
+void* executarTrechoLote(void* arg) {
+    TrechoLote* t = (TrechoLote*) arg;
+    if (t->meio == 0)
+        ordenarPorPalavras(t->chaves + t->inicio, t->fim - t->inicio, 0);
+    else
+        intercalarChaves(t->chaves + t->inicio, t->meio - t->inicio,
+                         t->chaves + t->meio, t->fim - t->meio, t->destino + t->inicio);
+    return NULL;
+}
+
+// Roda os trechos em threads (o primeiro na thread atual)
+void executarTrechosLote(TrechoLote* trechos, int n) {
+    for (int i = 1; i < n; i++)
+        if (pthread_create(&trechos[i].thread, NULL, executarTrechoLote, &trechos[i]) != 0) {
+            printf("Erro ao criar thread da carga em lote\n");
+            exit(1);
+        }
+    executarTrechoLote(&trechos[0]);
+    for (int i = 1; i < n; i++) pthread_join(trechos[i].thread, NULL);
+}
+
+// Ordena as chaves; lotes grandes são divididos entre threads e os trechos
+// ordenados são intercalados dois a dois, também em paralelo
+void ordenarChaves(ChavePista* chaves, size_t n) {
+    int threads = 1;
+    if (n >= LOTE_PARALELO_PISTAS) {
+        long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+        while (threads * 2 <= MAX_THREADS_LOTE && threads * 2 <= nucleos) threads *= 2;
+    }
+    if (threads == 1) {
+        ordenarPorPalavras(chaves, n, 0);
+        return;
+    }
+
+    ChavePista* aux = (ChavePista*) malloc(n * sizeof(ChavePista));
+    if (!aux) { printf("Erro malloc carga em lote\n"); exit(1); }
+    totalMallocs++;
+    size_t limites[MAX_THREADS_LOTE + 1];
+    for (int i = 0; i <= threads; i++) limites[i] = n * i / threads;
+
+    TrechoLote trechos[MAX_THREADS_LOTE];
+    for (int i = 0; i < threads; i++)
+        trechos[i] = (TrechoLote) { .chaves = chaves, .inicio = limites[i], .fim = limites[i + 1] };
+    executarTrechosLote(trechos, threads);
+
+    // a cada rodada, trechos vizinhos se juntam; origem e destino se alternam
+    ChavePista* origem = chaves;
+    ChavePista* destino = aux;
+    for (int largura = 1; largura < threads; largura *= 2) {
+        int pares = 0;
+        for (int i = 0; i < threads; i += 2 * largura)
+            trechos[pares++] = (TrechoLote) { .chaves = origem, .destino = destino, .inicio = limites[i],
+                                              .meio = limites[i + largura], .fim = limites[i + 2 * largura] };
+        executarTrechosLote(trechos, pares);
+        ChavePista* t = origem;
+        origem = destino;
+        destino = t;
+    }
+    if (origem != chaves) memcpy(chaves, origem, n * sizeof(ChavePista));
+    free(aux);
+}
+
+// Religa nós já em ordem numa árvore perfeitamente balanceada
+Pista* ligarBalanceada(Pista** nos, size_t n) {
+    if (n == 0) return NULL;
+    size_t meio = n / 2;
+    Pista* p = nos[meio];
+    p->esquerda = ligarBalanceada(nos, meio);
+    p->direita = ligarBalanceada(nos + meio + 1, n - meio - 1);
+    atualizarAltura(p);
+    return p;
+}
+
+// Importa 'n' textos de pista para a árvore da sessão; retorna quantas pistas
+// novas entraram (textos já presentes ou repetidos no lote não contam)
+size_t importarPistas(Sessao* sessao, const char* const* textos, size_t n) {
+    CONTAR(sessao->estatPistas.insercoes += n);
+    ChavePista* novas = (ChavePista*) malloc((n ? n : 1) * sizeof(ChavePista));
+    if (!novas) { printf("Erro malloc carga em lote\n"); exit(1); }
+    totalMallocs++;
+
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t id = internarPista(&sessao->pool, textos[i]);
+        if (pistaNaArvore(sessao, id)) continue;
+        novas[k++].no = criarPista(sessao, id);    // marca o id no bitset
+    }
+    if (k == 0) {
+        free(novas);
+        return 0;
+    }
+    // só agora os textos param de mudar de lugar (o pool cresce por realloc)
+    for (size_t i = 0; i < k; i++) {
+        novas[i].prefixo = novas[i].no->prefixo;
+        novas[i].texto = textoPista(&sessao->pool, novas[i].no->pista);
+    }
+    ordenarChaves(novas, k);
+
+    // nós da árvore atual em ordem (percurso iterativo), intercalados com os novos
+    size_t total = sessao->arenaPistas.objetos;
+    Pista** nos = (Pista**) malloc(total * sizeof(Pista*));
+    if (!nos) { printf("Erro malloc carga em lote\n"); exit(1); }
+    totalMallocs++;
+    CursorPistas c;
+    size_t m = 0, j = 0;
+    for (iniciarCursorPistas(&c, sessao->arvorePistas); pistaDoCursor(&c) != NULL; avancarCursorPistas(&c)) {
+        Pista* atual = pistaDoCursor(&c);
+        ChavePista chave = { atual->prefixo, textoPista(&sessao->pool, atual->pista), atual };
+        while (j < k && compararChaves(&novas[j], &chave, 0) < 0) nos[m++] = novas[j++].no;
+        nos[m++] = atual;
+    }
+    while (j < k) nos[m++] = novas[j++].no;
+
+    sessao->arvorePistas = ligarBalanceada(nos, m);
+    free(nos);
+    free(novas);
+    return k;
+}
+
+// Importa um arquivo com uma pista por linha (linhas vazias são ignoradas);
+// retorna quantas pistas novas entraram ou -1 se o arquivo não abrir
+long importarPistasDeArquivo(Sessao* sessao, const char* caminho) {
+    size_t lido;
+    char* buf = lerArquivoInteiro(caminho, &lido);
+    if (buf == NULL) return -1;
+    size_t linhas = 1;
+    for (char* p = buf; (p = memchr(p, '\n', buf + lido - p)) != NULL; p++) linhas++;
+    const char** textos = (const char**) malloc(linhas * sizeof(char*));
+    if (!textos) { printf("Erro malloc carga em lote\n"); exit(1); }
+    totalMallocs++;
+
+    size_t n = 0;
+    char* linha = buf;
+    while (linha < buf + lido) {
+        char* fim = memchr(linha, '\n', buf + lido - linha);
+        if (fim) *fim = '\0';
+        linha[strcspn(linha, "\r")] = '\0';
+        if (linha[0] != '\0') textos[n++] = linha;
+        linha = fim ? fim + 1 : buf + lido;
+    }
+    long novas = (long) importarPistas(sessao, textos, n);
+    free(textos);
+    free(buf);
+    return novas;
+}
+
+// Importação de associações (CSV/TSV)
+// Carrega pares suspeito/pista de um arquivo delimitado, uma associação por
+// linha: "suspeito<sep>pista", com sep ',' (CSV) ou tabulação (TSV),
+// escolhido pela primeira linha. Colunas a mais são ignoradas; uma primeira
+// linha "suspeito<sep>pista" é tratada como cabeçalho. No CSV, um campo
+// entre aspas pode conter o separador e "" vale uma aspa (mas não quebra de
+// linha).
+// O arquivo é lido com read() em blocos de TAM_BLOCO_IMPORTACAO e cada linha
+// é interpretada no próprio bloco: os campos viram strings no lugar (aspas
+// removidas por compactação), sem nenhuma alocação por campo. O texto da
+// pista vai para o pool da sessão e o nome do suspeito continua apontando
+// para o bloco até o lote ser inserido. Os lotes (até LOTE_IMPORTACAO linhas,
+// sempre esvaziados antes de o bloco ser reaproveitado) são ordenados pelo
+// bucket de destino na tabela de suspeitos (radix sort sobre os bits baixos
+// do hash), então as inserções varrem o vetor de buckets em ordem em vez de
+// saltar por ele. A memória de trabalho é fixa (um bloco e dois vetores de
+// lote), qualquer que seja o tamanho do arquivo; só crescem as estruturas
+// da sessão, com os suspeitos, pistas e relações distintos.
+
+#define TAM_BLOCO_IMPORTACAO (1 << 20)
+#define LOTE_IMPORTACAO 4096
+
+typedef struct AssociacaoLida {
+    uint64_t hash;             // calcularHash do nome (já truncado em MAX_NOME-1)
+    const char* suspeito;      // dentro do bloco de leitura
+    uint32_t pista;            // id no pool da sessão
+} AssociacaoLida;
+
+typedef struct EstatImportacao {
+    size_t bytes;
+    size_t linhas;             // linhas de dados (sem cabeçalho nem linhas vazias)
+    size_t invalidas;          // sem os dois campos ou maiores que o bloco
+    size_t novas;              // relações que a sessão ainda não tinha
+    double segundos;
+} EstatImportacao;
+
+// Separa o próximo campo da linha a partir de *p, terminando-o com '\0' no
+// próprio buffer, e avança *p para depois do separador (NULL no fim da linha)
+char* separarCampo(char** p, char sep) {
+    char* campo = *p;
+    if (sep == ',' && *campo == '"') {
+        char* ler = campo + 1;
+        char* escrever = campo;
+        while (*ler != '\0' && !(ler[0] == '"' && ler[1] != '"')) {
+            if (ler[0] == '"') ler++;          // "" → "
+            *escrever++ = *ler++;
+        }
+        if (*ler == '"') ler++;
+        *escrever = '\0';
+        char* prox = strchr(ler, sep);
+        *p = prox ? prox + 1 : NULL;
+        return campo;
+    }
+    char* prox = strchr(campo, sep);
+    if (prox) *prox++ = '\0';
+    *p = prox;
+    return campo;
+}
+
+// Cabeçalho opcional: a primeira linha é pulada se os dois primeiros campos
+// forem exatamente "suspeito" e "pista" (com ou sem aspas). Uma linha cujo
+// suspeito só começa com "suspeito" é importada como as outras.
+int ehCabecalhoAssociacoes(const char* linha, char sep) {
+    static const char* nomes[] = { "suspeito", "pista" };
+    for (int i = 0; i < 2; i++) {
+        int aspas = sep == ',' && *linha == '"';
+        linha += aspas;
+        size_t n = strlen(nomes[i]);
+        if (strncmp(linha, nomes[i], n) != 0) return 0;
+        linha += n;
+        if (aspas && *linha++ != '"') return 0;
+        if (*linha != sep && (i == 0 || *linha != '\0')) return 0;
+        linha++;
+    }
+    return 1;
+}
+
+// Ordena o lote pelo bucket de destino (hash & mascara), do menor para o
+// maior, com radix sort LSD de 8 bits; retorna o vetor que ficou ordenado
+AssociacaoLida* ordenarPorBucket(AssociacaoLida* lote, AssociacaoLida* aux, size_t n, size_t mascara) {
+    for (int desloc = 0; desloc < 64 && (mascara >> desloc) != 0; desloc += 8) {
+        size_t conta[257] = { 0 };
+        for (size_t i = 0; i < n; i++) conta[((lote[i].hash & mascara) >> desloc & 0xff) + 1]++;
+        for (int d = 0; d < 256; d++) conta[d + 1] += conta[d];
+        for (size_t i = 0; i < n; i++) aux[conta[(lote[i].hash & mascara) >> desloc & 0xff]++] = lote[i];
+        AssociacaoLida* t = lote;
+        lote = aux;
+        aux = t;
+    }
+    return lote;
+}
+
+void inserirLoteAssociacoes(Sessao* sessao, AssociacaoLida* lote, AssociacaoLida* aux, size_t n) {
+    AssociacaoLida* ordenado = ordenarPorBucket(lote, aux, n, sessao->tabela.tamanho - 1);
+    for (size_t i = 0; i < n; i++)
+        inserirHashComHash(sessao, ordenado[i].suspeito, ordenado[i].hash, ordenado[i].pista);
+}
+
+// Interpreta uma linha (já terminada em '\0') e a põe no lote; retorna 0 se
+// ela não tiver suspeito e pista
+int lerAssociacao(Sessao* sessao, char* linha, char sep, AssociacaoLida* a) {
+    char* p = linha;
+    char* suspeito = separarCampo(&p, sep);
+    if (p == NULL) return 0;
+    char* pista = separarCampo(&p, sep);
+    if (suspeito[0] == '\0' || pista[0] == '\0') return 0;
+    if (strlen(suspeito) > MAX_NOME - 1) suspeito[MAX_NOME - 1] = '\0';   // como criarSuspeito
+    a->hash = calcularHash(suspeito);
+    a->suspeito = suspeito;
+    a->pista = internarPista(&sessao->pool, pista);
+    return 1;
+}
+
+// Importa as associações de 'caminho' ("-" para a entrada padrão) na sessão;
+// retorna 0 se o arquivo não puder ser aberto
+int importarAssociacoes(Sessao* sessao, const char* caminho, EstatImportacao* est) {
+    int fd = strcmp(caminho, "-") == 0 ? STDIN_FILENO : open(caminho, O_RDONLY);
+    if (fd < 0) return 0;
+    char* bloco = (char*) malloc(TAM_BLOCO_IMPORTACAO + 1);
+    AssociacaoLida* lote = (AssociacaoLida*) malloc(2 * LOTE_IMPORTACAO * sizeof(AssociacaoLida));
+    if (!bloco || !lote) { printf("Erro malloc importação\n"); exit(1); }
+    totalMallocs += 2;
+    memset(est, 0, sizeof(*est));
+    size_t relacoesAntes = sessao->relacoes.quantidade;
+    double t0 = agoraSegundos();
+
+    char sep = 0;              // decidido pela primeira linha
+    int primeira = 1, descartando = 0, fimArquivo = 0;
+    size_t cheio = 0, noLote = 0;
+    while (!fimArquivo || cheio > 0) {
+        while (!fimArquivo && cheio < TAM_BLOCO_IMPORTACAO) {
+            ssize_t n = read(fd, bloco + cheio, TAM_BLOCO_IMPORTACAO - cheio);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) fimArquivo = 1;
+            else {
+                cheio += (size_t) n;
+                est->bytes += (size_t) n;
+            }
+        }
+
+        // Linhas completas do bloco; no fim do arquivo, também a última sem '\n'
+        char* p = bloco;
+        char* limite = bloco + cheio;
+        while (p < limite) {
+            char* fim = memchr(p, '\n', limite - p);
+            if (fim == NULL) {
+                if (!fimArquivo) break;
+                fim = limite;          // há espaço para o '\0' depois do bloco
+            }
+            *fim = '\0';
+            char* linha = p;
+            p = fim + 1;
+            if (descartando) {         // resto de uma linha maior que o bloco
+                descartando = 0;
+                continue;
+            }
+            if (fim > linha && fim[-1] == '\r') fim[-1] = '\0';
+            if (linha[0] == '\0') continue;
+            if (primeira) {
+                primeira = 0;
+                sep = strchr(linha, '\t') ? '\t' : ',';
+                if (ehCabecalhoAssociacoes(linha, sep)) continue;
+            }
+            est->linhas++;
+            if (!lerAssociacao(sessao, linha, sep, &lote[noLote])) est->invalidas++;
+            else if (++noLote == LOTE_IMPORTACAO) {
+                inserirLoteAssociacoes(sessao, lote, lote + LOTE_IMPORTACAO, noLote);
+                noLote = 0;
+            }
+        }
+
+        // Os nomes do lote apontam para o bloco: insere antes de movê-lo
+        inserirLoteAssociacoes(sessao, lote, lote + LOTE_IMPORTACAO, noLote);
+        noLote = 0;
+        size_t resto = p < limite ? (size_t)(limite - p) : 0;
+        if (resto == TAM_BLOCO_IMPORTACAO) {   // linha sem '\n' maior que o bloco
+            if (!descartando) {
+                est->linhas++;
+                est->invalidas++;
+                descartando = 1;
+            }
+            resto = 0;
+        }
+        memmove(bloco, p, resto);
+        cheio = resto;
+    }
+
+    if (fd != STDIN_FILENO) close(fd);
+    free(bloco);
+    free(lote);
+    est->novas = sessao->relacoes.quantidade - relacoesAntes;
+    est->segundos = agoraSegundos() - t0;
+    return 1;
+}
+
+// Escreve uma pista na saída, no formato da listagem
+void escreverPista(Sessao* sessao, const Pista* p, Saida* out) {
+    if (out->formato == FORMATO_TEXTO) {
+        escreverTexto(out, "🧩 ");
+        escreverTexto(out, textoPista(&sessao->pool, p->pista));
+    } else {
+        escreverTexto(out, "pista\t");
+        escreverCampo(out, textoPista(&sessao->pool, p->pista));
+    }
+    escreverTexto(out, "\n");
+}
+
+// Escreve as pistas em ordem alfabética na saída
+void escreverPistas(Sessao* sessao, Pista* raiz, Saida* out) {
+    CursorPistas c;
+    for (iniciarCursorPistas(&c, raiz); pistaDoCursor(&c) != NULL; avancarCursorPistas(&c))
+        escreverPista(sessao, pistaDoCursor(&c), out);
+}
+
+// Escreve até 'limite' pistas posteriores a 'depois' ("" = desde a primeira),
+// em ordem: O(log n + limite). Retorna a última escrita (NULL se nenhuma) e
+// em 'haMais' diz se ainda há pistas depois dela.
+Pista* escreverPaginaPistas(Sessao* sessao, Pista* raiz, const char* depois, size_t limite,
+                            Saida* out, int* haMais) {
+    CursorPistas c;
+    buscarCursorPistas(&c, sessao, raiz, depois);
+    Pista* p = pistaDoCursor(&c);
+    if (p != NULL && depois[0] != '\0' && strcmp(textoPista(&sessao->pool, p->pista), depois) == 0)
+        avancarCursorPistas(&c);
+    Pista* ultima = NULL;
+    for (size_t n = 0; n < limite && (p = pistaDoCursor(&c)) != NULL; n++, avancarCursorPistas(&c)) {
+        escreverPista(sessao, p, out);
+        ultima = p;
+    }
+    *haMais = pistaDoCursor(&c) != NULL;
+    return ultima;
+}
+
+void listarPistas(Sessao* sessao, Pista* raiz) {
+    Saida* out = saidaPadrao(sessao);
+    escreverPistas(sessao, raiz, out);
+    descarregarSaida(out);
+}
+
+// Escreve a pista e os suspeitos que ela implica, consultando o índice reverso
+void escreverImplicadosDaPista(Sessao* sessao, uint32_t id, Saida* out) {
+    const char* pista = textoPista(&sessao->pool, id);
+    Implicacao* im = suspeitosDaPista(sessao, id);
+    if (out->formato == FORMATO_TEXTO) {
+        escreverTexto(out, "🧩 ");
+        escreverTexto(out, pista);
+        escreverTexto(out, im == NULL ? "\n   (nenhum suspeito implicado)\n" : "\n");
+        for (; im != NULL; im = im->prox) {
+            escreverTexto(out, "   → ");
+            escreverTexto(out, im->suspeito->nome);
+            escreverTexto(out, "\n");
+        }
+    } else {
+        for (; im != NULL; im = im->prox) {
+            escreverTexto(out, "implica\t");
+            escreverCampo(out, pista);
+            escreverTexto(out, "\t");
+            escreverCampo(out, im->suspeito->nome);
+            escreverTexto(out, "\n");
+        }
+    }
+}
+
+// Escreve, para cada pista da árvore (em ordem alfabética), os suspeitos que
+// ela implica
+void escreverImplicados(Sessao* sessao, Pista* raiz, Saida* out) {
+    CursorPistas c;
+    for (iniciarCursorPistas(&c, raiz); pistaDoCursor(&c) != NULL; avancarCursorPistas(&c))
+        escreverImplicadosDaPista(sessao, pistaDoCursor(&c)->pista, out);
+}
+
+// Busca de pistas
+// Prefixo: a árvore está em ordem alfabética, então as pistas com um prefixo
+// formam um intervalo contíguo. Um cursor é posicionado na primeira pista
+// >= prefixo e avança em ordem enquanto o prefixo bate: O(log n + k).
+// Trecho: os textos do pool ficam num bloco contíguo, então a busca varre o
+// bloco com memmem (vetorizado na libc) em vez de visitar nós da árvore. Cada
+// ocorrência é convertida no id do texto por busca binária em 'inicio' e
+// filtrada pelo bitset de pistas presentes na árvore.
+
+// Escreve uma pista encontrada pela busca no formato da saída
+void escreverPistaEncontrada(Saida* out, const char* texto) {
+    if (out->formato == FORMATO_TEXTO) {
+        escreverTexto(out, "🔎 ");
+        escreverTexto(out, texto);
+    } else {
+        escreverTexto(out, "pista\t");
+        escreverCampo(out, texto);
+    }
+    escreverTexto(out, "\n");
+}
+
+// Escreve as pistas que começam com 'prefixo', em ordem; retorna quantas
+size_t escreverPistasComPrefixo(Sessao* sessao, Pista* raiz, const char* prefixo, Saida* out) {
+    size_t tam = strlen(prefixo), encontradas = 0;
+    CursorPistas c;
+    // a primeira pista >= prefixo é a primeira que pode começar com ele
+    for (buscarCursorPistas(&c, sessao, raiz, prefixo); pistaDoCursor(&c) != NULL; avancarCursorPistas(&c)) {
+        const char* texto = textoPista(&sessao->pool, pistaDoCursor(&c)->pista);
+        if (strncmp(texto, prefixo, tam) != 0) break;
+        escreverPistaEncontrada(out, texto);
+        encontradas++;
+    }
+    return encontradas;
+}
+
+// Id local do texto que contém o deslocamento 'pos' do bloco do pool
+uint32_t textoNoDeslocamento(const PoolPistas* pool, size_t pos) {
+    uint32_t baixo = 0, alto = pool->quantidade;
+    while (alto - baixo > 1) {
+        uint32_t meio = baixo + (alto - baixo) / 2;
+        if (pool->inicio[meio] <= pos) baixo = meio;
+        else alto = meio;
+    }
+    return baixo;
+}
+
+// Escreve as pistas da árvore que contêm 'trecho' (em ordem de coleta dos
+// textos no pool); retorna quantas
+size_t escreverPistasComTrecho(Sessao* sessao, const char* trecho, Saida* out) {
+    size_t tamTrecho = strlen(trecho), encontradas = 0;
+    if (tamTrecho == 0) return 0;
+    const PoolPistas* pools[] = { sessao->pool.base, &sessao->pool };
+    for (int i = 0; i < 2; i++) {
+        const PoolPistas* pool = pools[i];
+        if (pool == NULL || pool->quantidade == 0) continue;
+        const char* bloco = pool->textos;
+        const char* fim = pool->textos + pool->usado;
+        const char* p;
+        while ((p = (const char*) memmem(bloco, fim - bloco, trecho, tamTrecho)) != NULL) {
+            uint32_t local = textoNoDeslocamento(pool, p - pool->textos);
+            const char* texto = pool->textos + pool->inicio[local];
+            if (pistaNaArvore(sessao, pool->primeiroId + local)) {
+                escreverPistaEncontrada(out, texto);
+                encontradas++;
+            }
+            bloco = texto + strlen(texto) + 1;   // uma vez por texto
+        }
+    }
+    return encontradas;
+}
+
+// Busca pelo menu: "termo*" procura por prefixo, qualquer outro termo por trecho
+void buscarPistas(Sessao* sessao, const char* termo, Saida* out) {
+    size_t tam = strlen(termo);
+    size_t n;
+    if (tam > 0 && tam <= MAX_LINHA_BUSCA && termo[tam - 1] == '*') {
+        char prefixo[MAX_LINHA_BUSCA];
+        memcpy(prefixo, termo, tam - 1);
+        prefixo[tam - 1] = '\0';
+        n = escreverPistasComPrefixo(sessao, sessao->arvorePistas, prefixo, out);
+    } else {
+        n = escreverPistasComTrecho(sessao, termo, out);
+    }
+    if (n == 0 && out->formato == FORMATO_TEXTO) escreverTexto(out, "(Nenhuma pista encontrada)\n");
+}
+
+// Grava pistas e associações da sessão num arquivo; retorna 0 em caso de erro
+int exportarSessao(Sessao* sessao, const char* caminho) {
+    int fd = open(caminho, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 0;
+    iniciarSaida(&sessao->saida, fd, formatoSaida);
+    escreverPistas(sessao, sessao->arvorePistas, &sessao->saida);
+    escreverAssociacoes(sessao, &sessao->saida);
+    descarregarSaida(&sessao->saida);
+    int ok = !sessao->saida.erro;
+    if (close(fd) != 0) ok = 0;
+    return ok;
+}
+
+// Funções da sessão
+
+void iniciarSessao(Sessao* sessao, int inicio) {
+    memset(sessao, 0, sizeof(*sessao));
+    sessao->atual = inicio;
+    inicializarHash(&sessao->tabela);
+    iniciarPool(&sessao->pool, &poolRegras);
+    sessao->arenaPistas.nome = "Pistas";
+    sessao->arenaSuspeitos.nome = "Suspeitos";
+    sessao->arenaRelacoes.nome = "Relações";
+}
+
+// Descarta pistas e suspeitos para começar outra investigação no mesmo mapa,
+// mantendo buckets, vetores e blocos de arena para reuso
+void reiniciarSessao(Sessao* sessao, int inicio) {
+    sessao->atual = inicio;
+    sessao->arvorePistas = NULL;
+    memset(&sessao->estatPistas, 0, sizeof(sessao->estatPistas));
+    limparHash(&sessao->tabela);
+    limparConjunto(&sessao->relacoes);
+    if (sessao->suspeitosPorPista)
+        memset(sessao->suspeitosPorPista, 0, sessao->capacidadePorPista * sizeof(Implicacao*));
+    if (sessao->naArvore) memset(sessao->naArvore, 0, sessao->palavrasNaArvore * sizeof(uint64_t));
+    sessao->tamanhoRanking = 0;
+    limparPool(&sessao->pool);
+    resetarArena(&sessao->arenaPistas);
+    resetarArena(&sessao->arenaSuspeitos);
+    resetarArena(&sessao->arenaRelacoes);
+}
+
+void liberarSessao(Sessao* sessao) {
+    liberarHash(&sessao->tabela);
+    liberarConjunto(&sessao->relacoes);
+    free(sessao->vistas);
+    free(sessao->fila);
+    free(sessao->paiNaBusca);
+    sessao->vistas = NULL;
+    sessao->fila = NULL;
+    sessao->paiNaBusca = NULL;
+    sessao->palavrasVistas = 0;
+    sessao->capacidadeFila = 0;
+    free(sessao->suspeitosPorPista);
+    sessao->suspeitosPorPista = NULL;
+    sessao->capacidadePorPista = 0;
+    free(sessao->naArvore);
+    sessao->naArvore = NULL;
+    sessao->palavrasNaArvore = 0;
+    free(sessao->ranking);
+    sessao->ranking = NULL;
+    sessao->tamanhoRanking = sessao->capacidadeRanking = 0;
+    free(sessao->candidatos);
+    sessao->candidatos = NULL;
+    sessao->capacidadeCandidatos = 0;
+    liberarPool(&sessao->pool);
+    liberarSaida(&sessao->saida);
+    liberarArena(&sessao->arenaPistas);
+    liberarArena(&sessao->arenaSuspeitos);
+    liberarArena(&sessao->arenaRelacoes);
+}
+
+// Tabela de suspeitos compartilhada
+// Vários investigadores (threads) registram suspeitos e associações numa
+// tabela só. Leituras (buscarSuspeitoCompartilhado, consultas e listagem)
+// não tomam trava nenhuma; escritas tomam uma de FAIXAS_COMPARTILHADA
+// travas, escolhida pelos bits baixos do hash. Como a tabela tem sempre ao
+// menos FAIXAS_COMPARTILHADA buckets, cada bucket pertence a uma faixa só e
+// sua cadeia só muda com a trava dessa faixa.
+//
+// As cadeias são feitas de elos (hash + suspeito), e cada vetor de buckets
+// tem os seus. Elos entram pela cabeça da cadeia com store-release depois
+// de preenchidos, então um leitor vê o elo inteiro ou não o vê. O
+// crescimento toma todas as faixas, monta num vetor novo elos novos para os
+// mesmos suspeitos e o publica, sem tocar nas cadeias do vetor antigo: um
+// leitor que pegou o vetor antigo termina a busca nele, sem repetir nem
+// esperar o escritor.
+//
+// Suspeitos removidos e vetores de buckets antigos (com seus elos) podem
+// estar sendo lidos, então são aposentados em vez de liberados (reclamação
+// por épocas): cada
+// participante anuncia a época global ao começar uma leitura e zero ao
+// terminar; a época avança quando todos os leitores ativos estão nela, e o
+// que foi aposentado na época e é liberado quando ela chega a e + 2.
+// Uma thread ocupa um lugar de participante entre entrarNaTabela e
+// sairDaTabela; lugares devolvidos são reaproveitados, então o limite vale
+// para threads registradas ao mesmo tempo, não ao longo da vida da tabela.
+#define FAIXAS_COMPARTILHADA 64      // potência de 2
+#define MAX_PARTICIPANTES 64         // threads registradas ao mesmo tempo numa tabela
+
+// Associação da tabela compartilhada: imutável depois de publicada
+typedef struct RelacaoCompartilhada {
+    uint32_t pista;                  // id no pool de regras
+    struct RelacaoCompartilhada* prox;
+} RelacaoCompartilhada;
+
+typedef struct SuspeitoCompartilhado {
+    char nome[MAX_NOME];
+    uint32_t id;
+    _Atomic int numPistas;
+    RelacaoCompartilhada* _Atomic pistas;           // cresce pela cabeça
+} SuspeitoCompartilhado;
+
+// Elo da cadeia de uma bucket; imutável depois de publicado, exceto 'prox'
+typedef struct EloCompartilhado {
+    uint64_t hash;
+    SuspeitoCompartilhado* suspeito;
+    struct EloCompartilhado* _Atomic prox;
+} EloCompartilhado;
+
+typedef struct BucketsCompartilhados {
+    size_t tamanho;                  // potência de 2, >= FAIXAS_COMPARTILHADA
+    EloCompartilhado* _Atomic cadeias[];
+} BucketsCompartilhados;
+
+// Trava de escrita e conjunto de relações (sem duplicatas) de uma faixa
+typedef struct FaixaCompartilhada {
+    _Alignas(64) pthread_mutex_t trava;
+    ConjuntoRelacoes relacoes;
+} FaixaCompartilhada;
+
+// Época anunciada por um participante (0 = fora de leitura), uma por linha de cache
+typedef struct LeitorCompartilhado {
+    _Alignas(64) _Atomic uint64_t epoca;
+    _Atomic int ocupado;             // lugar em uso por alguma thread
+} LeitorCompartilhado;
+
+typedef struct Aposentado {
+    void* ptr;
+    void (*liberar)(void*);
+    uint64_t epoca;
+    struct Aposentado* prox;
+} Aposentado;
+
+typedef struct TabelaCompartilhada {
+    BucketsCompartilhados* _Atomic buckets;
+    _Atomic size_t quantidade;
+    _Atomic uint32_t proximoId;
+    FaixaCompartilhada faixas[FAIXAS_COMPARTILHADA];
+    _Atomic uint64_t epocaGlobal;
+    _Atomic int participantes;       // lugares já usados alguma vez (os leitores a varrer)
+    LeitorCompartilhado leitores[MAX_PARTICIPANTES];
+    pthread_mutex_t travaLixo;       // protege 'lixo' e o avanço da época
+    Aposentado* lixo;
+    size_t aposentados;              // nós aposentados desde a criação
+    size_t liberados;                // ... e já liberados
+} TabelaCompartilhada;
+
+BucketsCompartilhados* alocarBucketsCompartilhados(size_t tamanho) {
+    BucketsCompartilhados* b = (BucketsCompartilhados*) calloc(1, sizeof(BucketsCompartilhados)
+                                   + tamanho * sizeof(SuspeitoCompartilhado*));
+    if (!b) { printf("Erro malloc tabela compartilhada\n"); exit(1); }
+    totalMallocs++;
+    b->tamanho = tamanho;
+    return b;
+}
+
+void iniciarTabelaCompartilhada(TabelaCompartilhada* t) {
+    memset(t, 0, sizeof(*t));
+    size_t tamanho = TAM_HASH_INICIAL > FAIXAS_COMPARTILHADA ? TAM_HASH_INICIAL : FAIXAS_COMPARTILHADA;
+    atomic_store(&t->buckets, alocarBucketsCompartilhados(tamanho));
+    atomic_store(&t->epocaGlobal, 1);
+    for (int i = 0; i < FAIXAS_COMPARTILHADA; i++) pthread_mutex_init(&t->faixas[i].trava, NULL);
+    pthread_mutex_init(&t->travaLixo, NULL);
+}
+
+// Registra a thread chamadora no primeiro lugar livre; o número devolvido
+// identifica suas leituras até sairDaTabela
+int entrarNaTabela(TabelaCompartilhada* t) {
+    for (int p = 0; p < MAX_PARTICIPANTES; p++) {
+        int livre = 0;
+        if (!atomic_compare_exchange_strong(&t->leitores[p].ocupado, &livre, 1)) continue;
+        int n = atomic_load(&t->participantes);
+        while (n <= p && !atomic_compare_exchange_weak(&t->participantes, &n, p + 1)) {}
+        return p;
+    }
+    printf("Participantes demais na tabela compartilhada (máximo %d)\n", MAX_PARTICIPANTES);
+    exit(1);
+}
+
+// Devolve o lugar de um participante fora de leitura (época 0), que pode ser
+// reaproveitado pelo próximo entrarNaTabela
+void sairDaTabela(TabelaCompartilhada* t, int participante) {
+    atomic_store(&t->leitores[participante].ocupado, 0);
+}
+
+// Delimitam uma leitura: ponteiros obtidos entre as duas continuam válidos
+// até terminarLeitura, mesmo que o suspeito seja removido nesse meio tempo
+static inline void iniciarLeitura(TabelaCompartilhada* t, int participante) {
+    atomic_store(&t->leitores[participante].epoca, atomic_load(&t->epocaGlobal));
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+static inline void terminarLeitura(TabelaCompartilhada* t, int participante) {
+    atomic_store_explicit(&t->leitores[participante].epoca, 0, memory_order_release);
+}
+
+// Com travaLixo: avança a época se todos os leitores ativos já estão nela e
+// libera o que foi aposentado duas épocas atrás
+void coletarAposentados(TabelaCompartilhada* t) {
+    uint64_t e = atomic_load(&t->epocaGlobal);
+    int n = atomic_load(&t->participantes);
+    int todosNaEpoca = 1;
+    for (int i = 0; i < n && i < MAX_PARTICIPANTES && todosNaEpoca; i++) {
+        uint64_t x = atomic_load(&t->leitores[i].epoca);
+        todosNaEpoca = x == 0 || x == e;
+    }
+    if (todosNaEpoca) atomic_store(&t->epocaGlobal, ++e);
+
+    Aposentado** link = &t->lixo;
+    while (*link != NULL) {
+        Aposentado* a = *link;
+        if (a->epoca + 2 <= e) {
+            *link = a->prox;
+            a->liberar(a->ptr);
+            free(a);
+            t->liberados++;
+        } else {
+            link = &a->prox;
+        }
+    }
+}
+
+// Entrega 'ptr' para ser liberado quando nenhum leitor puder mais vê-lo
+void aposentar(TabelaCompartilhada* t, void* ptr, void (*liberar)(void*)) {
+    Aposentado* a = (Aposentado*) malloc(sizeof(Aposentado));
+    if (!a) { printf("Erro malloc tabela compartilhada\n"); exit(1); }
+    totalMallocs++;
+    a->ptr = ptr;
+    a->liberar = liberar;
+    pthread_mutex_lock(&t->travaLixo);
+    a->epoca = atomic_load(&t->epocaGlobal);
+    a->prox = t->lixo;
+    t->lixo = a;
+    t->aposentados++;
+    coletarAposentados(t);
+    pthread_mutex_unlock(&t->travaLixo);
+}
+
+void liberarSuspeitoCompartilhado(void* ptr) {
+    SuspeitoCompartilhado* s = (SuspeitoCompartilhado*) ptr;
+    RelacaoCompartilhada* r = atomic_load_explicit(&s->pistas, memory_order_relaxed);
+    while (r != NULL) {
+        RelacaoCompartilhada* prox = r->prox;
+        free(r);
+        r = prox;
+    }
+    free(s);
+}
+
+// Elo tirado da cadeia atual, junto com o suspeito dele
+void liberarEloRemovido(void* ptr) {
+    EloCompartilhado* e = (EloCompartilhado*) ptr;
+    liberarSuspeitoCompartilhado(e->suspeito);
+    free(e);
+}
+
+// Vetor de buckets substituído por um crescimento: os elos são dele, os
+// suspeitos continuam no vetor novo
+void liberarBucketsCompartilhados(void* ptr) {
+    BucketsCompartilhados* b = (BucketsCompartilhados*) ptr;
+    for (size_t i = 0; i < b->tamanho; i++) {
+        EloCompartilhado* e = atomic_load_explicit(&b->cadeias[i], memory_order_relaxed);
+        while (e != NULL) {
+            EloCompartilhado* prox = atomic_load_explicit(&e->prox, memory_order_relaxed);
+            free(e);
+            e = prox;
+        }
+    }
+    free(b);
+}
+
+SuspeitoCompartilhado* procurarNaCadeia(EloCompartilhado* e, const char* nome, uint64_t h) {
+    for (; e != NULL; e = atomic_load_explicit(&e->prox, memory_order_acquire))
+        if (e->hash == h && strcmp(e->suspeito->nome, nome) == 0) return e->suspeito;
+    return NULL;
+}
+
+// Busca sem trava nem repetição; só pode ser chamada entre iniciarLeitura e
+// terminarLeitura
+SuspeitoCompartilhado* buscarSuspeitoCompartilhado(TabelaCompartilhada* t, const char* nome) {
+    uint64_t h = calcularHash(nome);
+    BucketsCompartilhados* b = atomic_load_explicit(&t->buckets, memory_order_acquire);
+    return procurarNaCadeia(atomic_load_explicit(&b->cadeias[h & (b->tamanho - 1)], memory_order_acquire), nome, h);
+}
+
+EloCompartilhado* criarEloCompartilhado(uint64_t h, SuspeitoCompartilhado* s) {
+    EloCompartilhado* e = (EloCompartilhado*) malloc(sizeof(EloCompartilhado));
+    if (!e) { printf("Erro malloc tabela compartilhada\n"); exit(1); }
+    totalMallocs++;
+    e->hash = h;
+    e->suspeito = s;
+    return e;
+}
+
+// Número de pistas do suspeito, ou -1 se ele não está na tabela
+int consultarSuspeitoCompartilhado(TabelaCompartilhada* t, int participante, const char* nome) {
+    iniciarLeitura(t, participante);
+    SuspeitoCompartilhado* s = buscarSuspeitoCompartilhado(t, nome);
+    int n = s ? atomic_load_explicit(&s->numPistas, memory_order_relaxed) : -1;
+    terminarLeitura(t, participante);
+    return n;
+}
+
+void travarTodasAsFaixas(TabelaCompartilhada* t) {
+    for (int i = 0; i < FAIXAS_COMPARTILHADA; i++) pthread_mutex_lock(&t->faixas[i].trava);
+}
+
+void destravarTodasAsFaixas(TabelaCompartilhada* t) {
+    for (int i = FAIXAS_COMPARTILHADA - 1; i >= 0; i--) pthread_mutex_unlock(&t->faixas[i].trava);
+}
+
+// Dobra o número de buckets: o vetor novo recebe elos novos para os mesmos
+// suspeitos e as cadeias do antigo ficam intactas até ele ser liberado
+void crescerTabelaCompartilhada(TabelaCompartilhada* t) {
+    travarTodasAsFaixas(t);
+    BucketsCompartilhados* velho = atomic_load_explicit(&t->buckets, memory_order_relaxed);
+    if (atomic_load(&t->quantidade) <= velho->tamanho * CARGA_MAXIMA) {
+        destravarTodasAsFaixas(t);     // outra thread já cresceu a tabela
+        return;
+    }
+    BucketsCompartilhados* novo = alocarBucketsCompartilhados(velho->tamanho * 2);
+    for (size_t i = 0; i < velho->tamanho; i++) {
+        for (EloCompartilhado* e = atomic_load_explicit(&velho->cadeias[i], memory_order_relaxed);
+             e != NULL; e = atomic_load_explicit(&e->prox, memory_order_relaxed)) {
+            size_t j = e->hash & (novo->tamanho - 1);
+            EloCompartilhado* copia = criarEloCompartilhado(e->hash, e->suspeito);
+            atomic_store_explicit(&copia->prox, atomic_load_explicit(&novo->cadeias[j], memory_order_relaxed),
+                                  memory_order_relaxed);
+            atomic_store_explicit(&novo->cadeias[j], copia, memory_order_relaxed);
+        }
+    }
+    atomic_store_explicit(&t->buckets, novo, memory_order_release);
+    destravarTodasAsFaixas(t);
+    aposentar(t, velho, liberarBucketsCompartilhados);
+}
+
+// Associa a pista (id do pool de regras) ao suspeito, criando-o se preciso;
+// retorna 1 se a associação é nova. Só a faixa do nome fica travada.
+int associarCompartilhado(TabelaCompartilhada* t, const char* nome, uint32_t pista) {
+    uint64_t h = calcularHash(nome);
+    FaixaCompartilhada* f = &t->faixas[h & (FAIXAS_COMPARTILHADA - 1)];
+    pthread_mutex_lock(&f->trava);
+    BucketsCompartilhados* b = atomic_load_explicit(&t->buckets, memory_order_relaxed);
+    EloCompartilhado* _Atomic* cadeia = &b->cadeias[h & (b->tamanho - 1)];
+    SuspeitoCompartilhado* s = procurarNaCadeia(atomic_load_explicit(cadeia, memory_order_relaxed), nome, h);
+    int crescer = 0;
+    if (s == NULL) {
+        s = (SuspeitoCompartilhado*) calloc(1, sizeof(SuspeitoCompartilhado));
+        if (!s) { printf("Erro malloc tabela compartilhada\n"); exit(1); }
+        totalMallocs++;
+        strncpy(s->nome, nome, MAX_NOME - 1);
+        s->id = atomic_fetch_add(&t->proximoId, 1);
+        EloCompartilhado* e = criarEloCompartilhado(h, s);
+        atomic_store_explicit(&e->prox, atomic_load_explicit(cadeia, memory_order_relaxed), memory_order_relaxed);
+        atomic_store_explicit(cadeia, e, memory_order_release);
+        crescer = atomic_fetch_add(&t->quantidade, 1) + 1 > b->tamanho * CARGA_MAXIMA;
+    }
+    int nova = inserirNoConjunto(&f->relacoes, chaveRelacao(s->id, pista));
+    if (nova) {
+        RelacaoCompartilhada* r = (RelacaoCompartilhada*) malloc(sizeof(RelacaoCompartilhada));
+        if (!r) { printf("Erro malloc tabela compartilhada\n"); exit(1); }
+        totalMallocs++;
+        r->pista = pista;
+        r->prox = atomic_load_explicit(&s->pistas, memory_order_relaxed);
+        atomic_store_explicit(&s->pistas, r, memory_order_release);
+        atomic_fetch_add_explicit(&s->numPistas, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&f->trava);
+    if (crescer) crescerTabelaCompartilhada(t);
+    return nova;
+}
+
+// Tira o suspeito da tabela e suas chaves do conjunto da faixa; retorna 0
+// se ele não estava lá
+int removerSuspeitoCompartilhado(TabelaCompartilhada* t, const char* nome) {
+    uint64_t h = calcularHash(nome);
+    FaixaCompartilhada* f = &t->faixas[h & (FAIXAS_COMPARTILHADA - 1)];
+    pthread_mutex_lock(&f->trava);
+    BucketsCompartilhados* b = atomic_load_explicit(&t->buckets, memory_order_relaxed);
+    EloCompartilhado* _Atomic* link = &b->cadeias[h & (b->tamanho - 1)];
+    EloCompartilhado* e;
+    while ((e = atomic_load_explicit(link, memory_order_relaxed)) != NULL
+           && (e->hash != h || strcmp(e->suspeito->nome, nome) != 0))
+        link = &e->prox;
+    if (e != NULL) {
+        // 'e->prox' fica como está: quem estiver lendo 'e' segue a cadeia normalmente
+        atomic_store_explicit(link, atomic_load_explicit(&e->prox, memory_order_relaxed), memory_order_release);
+        atomic_fetch_sub(&t->quantidade, 1);
+        SuspeitoCompartilhado* s = e->suspeito;
+        for (RelacaoCompartilhada* r = atomic_load_explicit(&s->pistas, memory_order_relaxed); r != NULL; r = r->prox)
+            removerDoConjunto(&f->relacoes, chaveRelacao(s->id, r->pista));
+    }
+    pthread_mutex_unlock(&f->trava);
+    if (e != NULL) aposentar(t, e, liberarEloRemovido);
+    return e != NULL;
+}
+
+// Escreve suspeitos e pistas sem travar os escritores, percorrendo o vetor
+// de buckets publicado no início; associações feitas durante a listagem
+// podem ou não aparecer.
+void escreverTabelaCompartilhada(TabelaCompartilhada* t, int participante, Saida* out) {
+    int texto = out->formato == FORMATO_TEXTO;
+    size_t n = 0;
+    if (texto) escreverTexto(out, "\n=== Tabela Compartilhada de Suspeitos ===\n");
+    iniciarLeitura(t, participante);
+    BucketsCompartilhados* b = atomic_load_explicit(&t->buckets, memory_order_acquire);
+    for (size_t i = 0; i < b->tamanho; i++) {
+        for (EloCompartilhado* e = atomic_load_explicit(&b->cadeias[i], memory_order_acquire);
+             e != NULL; e = atomic_load_explicit(&e->prox, memory_order_acquire)) {
+            SuspeitoCompartilhado* s = e->suspeito;
+            RelacaoCompartilhada* r = atomic_load_explicit(&s->pistas, memory_order_acquire);
+            n++;
+            if (texto) {
+                escreverTexto(out, "\n👤 Suspeito: ");
+                escreverTexto(out, s->nome);
+                escreverTexto(out, r == NULL ? "\n   (nenhuma pista associada)\n" : "\n");
+            }
+            for (; r != NULL; r = r->prox) {
+                const char* pista = textoPista(&poolRegras, r->pista);
+                if (texto) {
+                    escreverTexto(out, "   - ");
+                    escreverTexto(out, pista);
+                } else {
+                    escreverTexto(out, "suspeito\t");
+                    escreverCampo(out, s->nome);
+                    escreverTexto(out, "\t");
+                    escreverCampo(out, pista);
+                }
+                escreverTexto(out, "\n");
+            }
+        }
+    }
+    terminarLeitura(t, participante);
+    if (n == 0 && texto) escreverTexto(out, "(Nenhum suspeito registrado ainda)\n");
+}
+
+// Libera tudo; nenhuma outra thread pode estar usando a tabela
+void liberarTabelaCompartilhada(TabelaCompartilhada* t) {
+    BucketsCompartilhados* b = atomic_load(&t->buckets);
+    for (size_t i = 0; i < b->tamanho; i++)
+        for (EloCompartilhado* e = atomic_load(&b->cadeias[i]); e != NULL; e = atomic_load(&e->prox))
+            liberarSuspeitoCompartilhado(e->suspeito);
+    liberarBucketsCompartilhados(b);
+    while (t->lixo != NULL) {
+        Aposentado* a = t->lixo;
+        t->lixo = a->prox;
+        a->liberar(a->ptr);
+        free(a);
+    }
+    for (int i = 0; i < FAIXAS_COMPARTILHADA; i++) {
+        pthread_mutex_destroy(&t->faixas[i].trava);
+        liberarConjunto(&t->faixas[i].relacoes);
+    }
+    pthread_mutex_destroy(&t->travaLixo);
+}
+
+// Regras de coleta (sala → pista e suspeitos)
+// As regras ficam numa tabela indexada pelo id da sala, então visitar uma
+// sala custa uma consulta ao vetor, independente de quantas regras existam.
+// As regras vêm das tabelas geradas de mansao.txt ou são carregadas na
+// inicialização, de um arquivo (--regras arquivo) ou, num mapa de arquivo,
+// das linhas de REGRAS_PADRAO, com uma regra por linha:
+//   pista|<sala>|<texto da pista guardada na BST>
+//   suspeito|<sala>|<suspeito>|<pista associada na hash>
+// Linhas vazias ou iniciadas por '#' são ignoradas.
+
+#define MAX_LINHA_REGRA 512
+
+// Associação suspeito ↔ pista feita ao visitar a sala
+typedef struct AssociacaoRegra {
+    char suspeito[MAX_NOME];
+    uint32_t pista;                     // id no pool de regras
+    struct AssociacaoRegra* prox;
+} AssociacaoRegra;
+
+typedef struct RegraSala {
+    uint32_t pista;                     // pista inserida na BST (ID_PISTA_NENHUMA se nenhuma)
+    AssociacaoRegra* associacoes;       // aplicadas na ordem em que foram carregadas
+    AssociacaoRegra* ultima;
+} RegraSala;
+
+RegraSala** regrasPorSala = NULL;   // um slot por sala (NULL = sala sem regra)
+int regrasGeradas = 0;              // 1: regras e pool apontam para as tabelas geradas
+
+// Retorna a regra da sala, criando uma vazia se ainda não existir
+RegraSala* regraDaSala(int sala) {
+    if (regrasPorSala == NULL) {
+        regrasPorSala = (RegraSala**) calloc(totalSalas, sizeof(RegraSala*));
+        if (!regrasPorSala) { printf("Erro malloc tabela de regras\n"); exit(1); }
+        totalMallocs++;
+    }
+    RegraSala* r = regrasPorSala[sala];
+    if (r == NULL) {
+        r = (RegraSala*) alocarArena(&arenaRegras, sizeof(RegraSala));
+        r->pista = ID_PISTA_NENHUMA;
+        r->associacoes = r->ultima = NULL;
+        regrasPorSala[sala] = r;
+    }
+    return r;
+}
+
+// Interpreta uma linha de regra; retorna 0 se a linha for inválida
+int adicionarRegra(const char* linha) {
+    char buf[MAX_LINHA_REGRA];
+    strncpy(buf, linha, MAX_LINHA_REGRA-1);
+    buf[MAX_LINHA_REGRA-1] = '\0';
+    buf[strcspn(buf, "\r\n")] = '\0';
+    if (buf[0] == '\0' || buf[0] == '#') return 1;
+
+    char* campos[4];
+    int n = 0;
+    char* p = buf;
+    while (n < 4) {
+        campos[n++] = p;
+        p = strchr(p, '|');
+        if (p == NULL) break;
+        *p++ = '\0';
+    }
+
+    int ehPista = strcmp(campos[0], "pista") == 0 && n == 3;
+    int ehSuspeito = strcmp(campos[0], "suspeito") == 0 && n == 4;
+    if (!ehPista && !ehSuspeito) return 0;
+
+    int sala = buscarSalaPorNome(campos[1]);
+    if (sala == SALA_NENHUMA) {
+        printf("Regra ignorada: sala '%s' não existe.\n", campos[1]);
+        return 1;
+    }
+    RegraSala* regra = regraDaSala(sala);
+
+    if (ehPista) {
+        regra->pista = internarPista(&poolRegras, campos[2]);
+    } else {
+        AssociacaoRegra* a = (AssociacaoRegra*) alocarArena(&arenaRegras, sizeof(AssociacaoRegra));
+        strncpy(a->suspeito, campos[2], MAX_NOME-1);
+        a->suspeito[MAX_NOME-1] = '\0';
+        a->pista = internarPista(&poolRegras, campos[3]);
+        a->prox = NULL;
+        if (regra->ultima) regra->ultima->prox = a;
+        else regra->associacoes = a;
+        regra->ultima = a;
+    }
+    return 1;
+}
+
+// Carrega regras de um arquivo; retorna 0 se não conseguir abri-lo
+int carregarRegrasDeArquivo(const char* caminho) {
+    FILE* f = fopen(caminho, "r");
+    if (!f) return 0;
+    char linha[MAX_LINHA_REGRA];
+    int numLinha = 0;
+    while (fgets(linha, sizeof(linha), f) != NULL) {
+        numLinha++;
+        if (!adicionarRegra(linha)) printf("Regra inválida na linha %d de %s\n", numLinha, caminho);
+    }
+    fclose(f);
+    return 1;
+}
+
+// Aplica a regra da sala atual da sessão: pista na BST e associações na hash
+void aplicarRegrasDaSala(Sessao* sessao) {
+    if (regrasPorSala == NULL) return;
+    RegraSala* regra = regrasPorSala[sessao->atual];
+    if (regra == NULL) return;
+    if (regra->pista != ID_PISTA_NENHUMA)
+        sessao->arvorePistas = inserirPistaId(sessao, sessao->arvorePistas, regra->pista);
+    for (AssociacaoRegra* a = regra->associacoes; a != NULL; a = a->prox) {
+        inserirHashId(sessao, a->suspeito, a->pista);
+        if (sessao->compartilhada) associarCompartilhado(sessao->compartilhada, a->suspeito, a->pista);
+    }
+}
+
+void liberarRegras() {
+    if (regrasGeradas) {       // tabelas do binário: só esquece os ponteiros
+        regrasPorSala = NULL;
+        iniciarPool(&poolRegras, NULL);
+        regrasGeradas = 0;
+    }
+    free(regrasPorSala);
+    regrasPorSala = NULL;
+    liberarArena(&arenaRegras);
+    liberarPool(&poolRegras);
+}
+
+// Tabelas geradas
+// A mansão padrão (salas, portas e regras de coleta) é descrita em mansao.txt
+// e convertida por gerar_tabelas.c em mansao_tabelas.h: vetores static const
+// com o mapa já renumerado em largura, o grafo CSR, as tabelas de rotas, o
+// índice de nomes, o pool de textos das regras e as próprias regras, no
+// mesmo formato que a montagem em tempo de execução produziria (o gerador
+// usa as funções deste arquivo). Sem --mapa nem --regras, a inicialização só
+// aponta os globais para essas tabelas: nenhuma alocação, e o mapa fica em
+// páginas somente leitura do binário, compartilhadas por todos os processos
+// do jogo. Refazer o cabeçalho quando mansao.txt mudar:
+//   gcc -O2 -pthread gerar_tabelas.c -o gerar_tabelas && ./gerar_tabelas mansao.txt mansao_tabelas.h
+// (o gerador define NIVEL_MESTRE_SEM_TABELAS e não inclui o cabeçalho antigo)
+
+// Texto cujo calcularHash o gerador grava no cabeçalho (TABELA_HASH_PROVA):
+// hashes e índices das tabelas só valem com o mesmo calcularHash
+#define TEXTO_PROVA_TABELAS "Detective Quest: prova das tabelas"
+
+#ifndef NIVEL_MESTRE_SEM_TABELAS
+#define TABELAS_NIVEL_MESTRE
+#include "mansao_tabelas.h"
+
+// O cabeçalho é refeito à mão (gerar_tabelas), então pode ter ficado para
+// trás de uma mudança neste arquivo: tipos e bloco do LCA são conferidos na
+// compilação e o hash em usarTabelasGeradas
+#define MENSAGEM_TABELAS_ANTIGAS "mansao_tabelas.h desatualizado: gere de novo com ./gerar_tabelas mansao.txt mansao_tabelas.h"
+_Static_assert(sizeof(Sala) == TABELA_TAM_SALA
+               && offsetof(Sala, esquerda) == TABELA_POS_SALA_ESQUERDA
+               && offsetof(Sala, direita) == TABELA_POS_SALA_DIREITA, MENSAGEM_TABELAS_ANTIGAS);
+_Static_assert(sizeof(RegraSala) == TABELA_TAM_REGRA_SALA, MENSAGEM_TABELAS_ANTIGAS);
+_Static_assert(sizeof(AssociacaoRegra) == TABELA_TAM_ASSOCIACAO_REGRA, MENSAGEM_TABELAS_ANTIGAS);
+_Static_assert(TAM_BLOCO_LCA == TABELA_BLOCO_LCA, MENSAGEM_TABELAS_ANTIGAS);
+
+// Regras padrão num mapa de arquivo (--mapa sem --regras), pelo nome das salas
+void carregarRegrasPadrao() {
+    for (int i = 0; REGRAS_PADRAO[i] != NULL; i++) adicionarRegra(REGRAS_PADRAO[i]);
+}
+
+// Aponta o mapa (e, com 'comRegras', as regras e o pool de regras) para as
+// tabelas geradas. Os vetores são só lidos depois da inicialização; os
+// liberar* reconhecem as tabelas e não as devolvem ao sistema. Com um
+// calcularHash diferente do que gerou o cabeçalho, os índices de nomes e de
+// textos não achariam nada (e o pool duplicaria os textos): o jogo para.
+void usarTabelasGeradas(int comRegras) {
+    if (calcularHash(TEXTO_PROVA_TABELAS) != TABELA_HASH_PROVA) {
+        printf("%s (calcularHash mudou)\n", MENSAGEM_TABELAS_ANTIGAS);
+        exit(1);
+    }
+    salas = (Sala*) TABELA_SALAS;
+    totalSalas = capacidadeSalas = TABELA_TOTAL_SALAS;
+    nomesSalas = (char*) TABELA_NOMES_SALAS;
+    usadoNomesSalas = capacidadeNomesSalas = sizeof(TABELA_NOMES_SALAS) - 1;
+    indiceNomesSalas = (int*) TABELA_INDICE_NOMES;
+    tamanhoIndiceNomes = sizeof(TABELA_INDICE_NOMES) / sizeof(int);
+    inicioPortas = (int*) TABELA_INICIO_PORTAS;
+    destinoPortas = (int*) TABELA_DESTINO_PORTAS;
+    totalPortas = TABELA_TOTAL_PORTAS;
+    paiSala = (int*) TABELA_PAI;
+    profundidadeSala = (int*) TABELA_PROFUNDIDADE;
+    primeiraNoPasseio = (int*) TABELA_PRIMEIRA_NO_PASSEIO;
+    passeioEuler = (int*) TABELA_PASSEIO;
+    profundidadeNoPasseio = (int*) TABELA_PROFUNDIDADE_NO_PASSEIO;
+    tamanhoPasseio = TABELA_TAMANHO_PASSEIO;
+    minimoDoBloco = (int*) TABELA_MINIMO_DO_BLOCO;
+    blocosPasseio = TABELA_BLOCOS_PASSEIO;
+    tabelaEsparsa = (int*) TABELA_ESPARSA;
+    niveisEsparsa = TABELA_NIVEIS_ESPARSA;
+    mapaGerado = 1;
+    if (!comRegras) return;
+
+    iniciarPool(&poolRegras, NULL);
+    poolRegras.textos = (char*) TABELA_TEXTOS_REGRAS;
+    poolRegras.usado = poolRegras.capacidade = sizeof(TABELA_TEXTOS_REGRAS) - 1;
+    poolRegras.inicio = (size_t*) TABELA_INICIO_TEXTOS;
+    poolRegras.hashes = (uint64_t*) TABELA_HASHES_TEXTOS;
+    poolRegras.quantidade = poolRegras.capacidadeIds = TABELA_TOTAL_TEXTOS;
+    poolRegras.indice = (uint32_t*) TABELA_INDICE_TEXTOS;
+    poolRegras.tamanhoIndice = sizeof(TABELA_INDICE_TEXTOS) / sizeof(uint32_t);
+    regrasPorSala = (RegraSala**) TABELA_REGRAS_POR_SALA;
+    regrasGeradas = 1;
+}
+#endif
+
+// Snapshot binário da investigação
+// Grava o mapa, o pool de textos da sessão, as pistas da árvore e a tabela de
+// suspeitos num arquivo com seções de tamanho fixo (alinhadas a 8 bytes), na
+// ordem do cabeçalho. Para retomar, o arquivo é mapeado com mmap e os vetores
+// (textos, deslocamentos, hashes, índice do pool, conjunto de relações) são
+// copiados em bloco com memcpy; os nós são recriados nas arenas sem nenhum
+// hash ou comparação de texto:
+//   - a árvore vem das pistas em ordem alfabética, montada já balanceada em O(n);
+//   - os suspeitos vêm na ordem do heap de ranking e voltam às buckets pelo
+//     hash guardado;
+//   - o índice reverso é refeito percorrendo as relações.
+// Os ids das pistas das regras não são gravados: o snapshot guarda uma soma
+// dos hashes do pool de regras e só é aceito com as mesmas regras.
+
+#define MAGICO_SNAPSHOT "DQSNAP01"
+
+typedef struct CabecalhoSnapshot {
+    char magico[8];
+    uint32_t totalSalas;
+    int32_t salaAtual;         // -1: fora do mapa
+    uint32_t primeiroId;       // textos do pool de regras
+    uint32_t numTextos;        // textos do pool da sessão
+    uint64_t somaRegras;       // identifica o pool de regras usado
+    uint64_t bytesTextos;
+    uint64_t tamanhoIndice;
+    uint64_t numPistas;        // nós da árvore
+    uint64_t tamanhoTabela;    // buckets da tabela de suspeitos
+    uint64_t numSuspeitos;
+    uint64_t numRelacoes;
+    uint64_t tamanhoConjunto;
+    EstatPistas estatPistas;
+} CabecalhoSnapshot;
+
+typedef struct SalaSnapshot {
+    char nome[MAX_NOME];
+    int32_t esquerda;          // id da sala, -1 se não houver
+    int32_t direita;
+} SalaSnapshot;
+
+typedef struct SuspeitoSnapshot {
+    char nome[MAX_NOME];
+    uint32_t id;
+    int32_t numPistas;         // relações deste suspeito na seção de relações
+    uint64_t hash;
+} SuspeitoSnapshot;
+
+uint64_t somaDoPool(const PoolPistas* pool) {
+    uint64_t h = pool->quantidade;
+    for (uint32_t i = 0; i < pool->quantidade; i++) h = misturarHash(h ^ pool->hashes[i]);
+    return h;
+}
+
+// Completa a seção com zeros até o próximo múltiplo de 8 bytes
+void alinharSecao(Saida* out, size_t tamanho) {
+    static const char zeros[8] = { 0 };
+    if (tamanho % 8) escreverBytes(out, zeros, 8 - tamanho % 8);
+}
+
+// Ids das pistas da árvore em ordem alfabética
+void escreverIdsEmOrdem(Pista* raiz, Saida* out) {
+    CursorPistas c;
+    for (iniciarCursorPistas(&c, raiz); pistaDoCursor(&c) != NULL; avancarCursorPistas(&c))
+        escreverBytes(out, (const char*) &pistaDoCursor(&c)->pista, sizeof(uint32_t));
+}
+
+// Grava o snapshot da sessão; retorna 0 em caso de erro
+int gravarSnapshot(Sessao* sessao, const char* caminho) {
+    int fd = open(caminho, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 0;
+    const PoolPistas* pool = &sessao->pool;
+    CabecalhoSnapshot c;
+    memset(&c, 0, sizeof(c));
+    memcpy(c.magico, MAGICO_SNAPSHOT, 8);
+    c.totalSalas = (uint32_t) totalSalas;
+    c.salaAtual = sessao->atual;
+    c.primeiroId = pool->primeiroId;
+    c.numTextos = pool->quantidade;
+    c.somaRegras = somaDoPool(&poolRegras);
+    c.bytesTextos = pool->usado;
+    c.tamanhoIndice = pool->tamanhoIndice;
+    c.numPistas = sessao->arenaPistas.objetos;
+    c.tamanhoTabela = sessao->tabela.tamanho;
+    c.numSuspeitos = sessao->tamanhoRanking;
+    c.numRelacoes = sessao->relacoes.quantidade;
+    c.tamanhoConjunto = sessao->relacoes.tamanho;
+    c.estatPistas = sessao->estatPistas;
+
+    // Saída própria: a da sessão pode ser a que recebe a resposta do comando
+    Saida arquivo;
+    memset(&arquivo, 0, sizeof(arquivo));
+    Saida* out = &arquivo;
+    iniciarSaida(out, fd, FORMATO_TEXTO);
+    escreverBytes(out, (const char*) &c, sizeof(c));
+    alinharSecao(out, sizeof(c));
+
+    for (int i = 0; i < totalSalas; i++) {
+        SalaSnapshot s;
+        memset(&s, 0, sizeof(s));
+        strncpy(s.nome, nomeSala(i), MAX_NOME - 1);
+        s.esquerda = salas[i].esquerda;
+        s.direita = salas[i].direita;
+        escreverBytes(out, (const char*) &s, sizeof(s));
+    }
+    alinharSecao(out, (size_t) totalSalas * sizeof(SalaSnapshot));
+
+    escreverBytes(out, pool->textos, pool->usado);
+    alinharSecao(out, pool->usado);
+    for (uint32_t i = 0; i < pool->quantidade; i++) {
+        uint64_t inicio = pool->inicio[i];
+        escreverBytes(out, (const char*) &inicio, sizeof(inicio));
+    }
+    escreverBytes(out, (const char*) pool->hashes, pool->quantidade * sizeof(uint64_t));
+    escreverBytes(out, (const char*) pool->indice, pool->tamanhoIndice * sizeof(uint32_t));
+    alinharSecao(out, pool->tamanhoIndice * sizeof(uint32_t));
+
+    escreverIdsEmOrdem(sessao->arvorePistas, out);
+    alinharSecao(out, c.numPistas * sizeof(uint32_t));
+
+    for (size_t i = 0; i < sessao->tamanhoRanking; i++) {
+        Suspeito* s = sessao->ranking[i];
+        SuspeitoSnapshot r;
+        memset(&r, 0, sizeof(r));
+        memcpy(r.nome, s->nome, MAX_NOME);
+        r.id = s->id;
+        r.numPistas = s->numPistas;
+        r.hash = s->hash;
+        escreverBytes(out, (const char*) &r, sizeof(r));
+    }
+    for (size_t i = 0; i < sessao->tamanhoRanking; i++)
+        for (Relacao* r = sessao->ranking[i]->pistas; r != NULL; r = r->prox)
+            escreverBytes(out, (const char*) &r->pista, sizeof(uint32_t));
+    alinharSecao(out, c.numRelacoes * sizeof(uint32_t));
+    escreverBytes(out, (const char*) sessao->relacoes.chaves, sessao->relacoes.tamanho * sizeof(uint64_t));
+
+    descarregarSaida(out);
+    int ok = !out->erro;
+    liberarSaida(out);
+    if (close(fd) != 0) ok = 0;
+    return ok;
+}
+
+// Leitura sequencial das seções do arquivo mapeado, com verificação de limites
+typedef struct LeitorSnapshot {
+    const char* dados;
+    size_t tamanho;
+    size_t pos;
+} LeitorSnapshot;
+
+// Devolve a próxima seção com n elementos de 'tamElem' bytes, ou NULL se o
+// arquivo for curto demais
+const void* lerSecao(LeitorSnapshot* l, uint64_t n, size_t tamElem) {
+    if (n > (l->tamanho - l->pos) / tamElem) return NULL;
+    size_t bytes = (size_t) n * tamElem;
+    const void* p = l->dados + l->pos;
+    l->pos += bytes;
+    l->pos += (8 - l->pos % 8) % 8;
+    if (l->pos > l->tamanho) l->pos = l->tamanho;
+    return p;
+}
+
+int potenciaDeDois(uint64_t n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+// Monta uma AVL balanceada a partir de ids em ordem alfabética: o meio vira a
+// raiz e as metades diferem em no máximo um nó, então as alturas também
+Pista* montarArvore(Sessao* sessao, const uint32_t* ids, size_t n) {
+    if (n == 0) return NULL;
+    size_t meio = n / 2;
+    Pista* p = criarPista(sessao, ids[meio]);
+    p->esquerda = montarArvore(sessao, ids, meio);
+    p->direita = montarArvore(sessao, ids + meio + 1, n - meio - 1);
+    atualizarAltura(p);
+    return p;
+}
+
+// Pool gravado: textos contíguos (cada um termina no início do seguinte), o
+// hash de cada texto confere e o índice tem exatamente um slot por texto,
+// alcançável a partir do hash, e ao menos um slot livre
+int validarPoolSnapshot(const CabecalhoSnapshot* c, const char* textos, const uint64_t* inicio,
+                        const uint64_t* hashes, const uint32_t* indice) {
+    if (c->numTextos == 0 && c->bytesTextos != 0) return 0;
+    if (c->numTextos > 0 && inicio[0] != 0) return 0;
+    for (uint32_t i = 0; i < c->numTextos; i++) {
+        uint64_t fim = i + 1 < c->numTextos ? inicio[i + 1] : c->bytesTextos;
+        if (fim <= inicio[i] || fim > c->bytesTextos) return 0;
+        if (memchr(textos + inicio[i], '\0', fim - inicio[i]) != textos + fim - 1) return 0;
+        if (hashes[i] != calcularHash(textos + inicio[i])) return 0;
+    }
+
+    if (c->tamanhoIndice == 0) return c->numTextos == 0;
+    if (!potenciaDeDois(c->tamanhoIndice) || c->tamanhoIndice <= c->numTextos) return 0;
+    uint64_t ocupados = 0;
+    for (uint64_t i = 0; i < c->tamanhoIndice; i++) {
+        if (indice[i] > c->numTextos) return 0;
+        if (indice[i] != 0) ocupados++;
+    }
+    if (ocupados != c->numTextos) return 0;
+    uint64_t mascara = c->tamanhoIndice - 1;
+    for (uint32_t local = 0; local < c->numTextos; local++) {
+        uint64_t i = hashes[local] & mascara;
+        while (indice[i] != local + 1) {
+            uint32_t outro = indice[i];
+            if (outro == 0) return 0;          // fora do alcance da sondagem
+            if (hashes[outro - 1] == hashes[local]
+                && strcmp(textos + inicio[outro - 1], textos + inicio[local]) == 0) return 0;  // repetido
+            i = (i + 1) & mascara;
+        }
+    }
+    return 1;
+}
+
+// Suspeitos gravados: hash do nome, ids 0..n-1 sem repetição, ordem de heap
+// do ranking e conjunto de relações com exatamente as relações gravadas
+int validarSuspeitosSnapshot(const CabecalhoSnapshot* c, const SuspeitoSnapshot* suspeitos,
+                             const uint32_t* relacoes, const uint64_t* conjunto) {
+    size_t bits = c->numSuspeitos > c->tamanhoConjunto ? c->numSuspeitos : c->tamanhoConjunto;
+    uint64_t* marcas = (uint64_t*) calloc(bits / 64 + 1, sizeof(uint64_t));
+    if (!marcas) { printf("Erro malloc validação do snapshot\n"); exit(1); }
+    totalMallocs++;
+    int ok = 1;
+
+    for (uint64_t i = 0; ok && i < c->numSuspeitos; i++) {
+        const SuspeitoSnapshot* s = &suspeitos[i];
+        if (s->hash != calcularHash(s->nome) || s->id >= c->numSuspeitos
+            || (marcas[s->id / 64] >> (s->id % 64) & 1)) ok = 0;
+        else marcas[s->id / 64] |= 1ULL << (s->id % 64);
+        if (i > 0) {
+            const SuspeitoSnapshot* pai = &suspeitos[(i - 1) / 2];
+            if (s->numPistas > pai->numPistas || (s->numPistas == pai->numPistas && s->id < pai->id)) ok = 0;
+        }
+    }
+
+    uint64_t chavesGravadas = 0;
+    for (uint64_t i = 0; ok && i < c->tamanhoConjunto; i++)
+        if (conjunto[i] != 0) chavesGravadas++;
+    if (chavesGravadas != c->numRelacoes) ok = 0;
+    memset(marcas, 0, (bits / 64 + 1) * sizeof(uint64_t));
+    const uint32_t* rel = relacoes;
+    for (uint64_t i = 0; ok && i < c->numSuspeitos; i++) {
+        for (int32_t j = 0; ok && j < suspeitos[i].numPistas; j++) {
+            uint64_t chave = chaveRelacao(suspeitos[i].id, rel[j]);
+            uint64_t mascara = c->tamanhoConjunto - 1;
+            uint64_t k = misturarHash(chave) & mascara;
+            while (conjunto[k] != 0 && conjunto[k] != chave) k = (k + 1) & mascara;
+            if (conjunto[k] == 0 || (marcas[k / 64] >> (k % 64) & 1)) ok = 0;   // ausente ou repetida
+            else marcas[k / 64] |= 1ULL << (k % 64);
+        }
+        rel += suspeitos[i].numPistas;
+    }
+    free(marcas);
+    return ok;
+}
+
+// Texto de um id do snapshot (regras ou pool gravado), já validado
+const char* textoGravado(const CabecalhoSnapshot* c, const char* textos, const uint64_t* inicio, uint32_t id) {
+    return id < c->primeiroId ? textoPista(&poolRegras, id) : textos + inicio[id - c->primeiroId];
+}
+
+// Confere as seções antes de tocar na sessão; retorna 0 se algo não bate.
+// Tudo o que será copiado em bloco (índice do pool, conjunto de relações) é
+// conferido contra os dados, para que um arquivo adulterado não deixe
+// sondagens sem fim nem entradas duplicadas.
+int validarSnapshot(const CabecalhoSnapshot* c, const SalaSnapshot* salasGravadas, const char* textos,
+                    const uint64_t* inicio, const uint64_t* hashes, const uint32_t* indice,
+                    const uint32_t* pistas, const SuspeitoSnapshot* suspeitos, const uint32_t* relacoes,
+                    const uint64_t* conjunto) {
+    if (c->primeiroId != poolRegras.quantidade || c->somaRegras != somaDoPool(&poolRegras)) return 0;
+    if (totalSalas != 0 && (uint32_t) totalSalas != c->totalSalas) return 0;
+    if (c->salaAtual < -1 || c->salaAtual >= (int64_t) c->totalSalas) return 0;
+    for (uint32_t i = 0; i < c->totalSalas; i++) {
+        if (salasGravadas[i].esquerda < -1 || salasGravadas[i].esquerda >= (int64_t) c->totalSalas) return 0;
+        if (salasGravadas[i].direita < -1 || salasGravadas[i].direita >= (int64_t) c->totalSalas) return 0;
+        if (memchr(salasGravadas[i].nome, '\0', MAX_NOME) == NULL) return 0;
+        if (totalSalas != 0 && strcmp(salasGravadas[i].nome, nomeSala(i)) != 0) return 0;
+    }
+
+    if (!validarPoolSnapshot(c, textos, inicio, hashes, indice)) return 0;
+
+    // ids da árvore: válidos e em ordem alfabética estrita
+    uint64_t totalIds = (uint64_t) c->primeiroId + c->numTextos;
+    for (uint64_t i = 0; i < c->numPistas; i++) {
+        if (pistas[i] >= totalIds) return 0;
+        if (i > 0 && strcmp(textoGravado(c, textos, inicio, pistas[i - 1]),
+                            textoGravado(c, textos, inicio, pistas[i])) >= 0) return 0;
+    }
+
+    if (!potenciaDeDois(c->tamanhoTabela)) return 0;
+    uint64_t relacoesUsadas = 0;
+    for (uint64_t i = 0; i < c->numSuspeitos; i++) {
+        if (suspeitos[i].numPistas < 0 || memchr(suspeitos[i].nome, '\0', MAX_NOME) == NULL) return 0;
+        relacoesUsadas += (uint64_t) suspeitos[i].numPistas;
+    }
+    if (relacoesUsadas != c->numRelacoes) return 0;
+    for (uint64_t i = 0; i < c->numRelacoes; i++)
+        if (relacoes[i] >= totalIds) return 0;
+    if (c->numRelacoes > 0 || c->tamanhoConjunto != 0)
+        if (!potenciaDeDois(c->tamanhoConjunto) || c->tamanhoConjunto <= c->numRelacoes) return 0;
+    return validarSuspeitosSnapshot(c, suspeitos, relacoes, conjunto);
+}
+
+// Retoma a investigação gravada em 'caminho', substituindo o estado da sessão.
+// Se o mapa ainda não existe, ele é criado a partir do snapshot; se existe,
+// precisa ser o mesmo. Retorna 0 se o arquivo não puder ser usado.
+int carregarSnapshot(Sessao* sessao, const char* caminho) {
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(CabecalhoSnapshot)) {
+        close(fd);
+        return 0;
+    }
+#ifdef MAP_POPULATE
+    int opcoesMapa = MAP_PRIVATE | MAP_POPULATE;   // lê o arquivo inteiro de uma vez
+#else
+    int opcoesMapa = MAP_PRIVATE;
+#endif
+    void* mapa = mmap(NULL, (size_t) info.st_size, PROT_READ, opcoesMapa, fd, 0);
+    close(fd);
+    if (mapa == MAP_FAILED) return 0;
+
+    LeitorSnapshot l = { (const char*) mapa, (size_t) info.st_size, 0 };
+    CabecalhoSnapshot c;
+    memcpy(&c, lerSecao(&l, 1, sizeof(c)), sizeof(c));
+    const SalaSnapshot* salasGravadas = NULL;
+    const char* textos = NULL;
+    const uint64_t *inicio = NULL, *hashes = NULL, *conjunto = NULL;
+    const uint32_t *indice = NULL, *pistas = NULL, *relacoes = NULL;
+    const SuspeitoSnapshot* suspeitos = NULL;
+    int ok = memcmp(c.magico, MAGICO_SNAPSHOT, 8) == 0
+          && (salasGravadas = lerSecao(&l, c.totalSalas, sizeof(SalaSnapshot))) != NULL
+          && (textos = lerSecao(&l, c.bytesTextos, 1)) != NULL
+          && (inicio = lerSecao(&l, c.numTextos, sizeof(uint64_t))) != NULL
+          && (hashes = lerSecao(&l, c.numTextos, sizeof(uint64_t))) != NULL
+          && (indice = lerSecao(&l, c.tamanhoIndice, sizeof(uint32_t))) != NULL
+          && (pistas = lerSecao(&l, c.numPistas, sizeof(uint32_t))) != NULL
+          && (suspeitos = lerSecao(&l, c.numSuspeitos, sizeof(SuspeitoSnapshot))) != NULL
+          && (relacoes = lerSecao(&l, c.numRelacoes, sizeof(uint32_t))) != NULL
+          && (conjunto = lerSecao(&l, c.tamanhoConjunto, sizeof(uint64_t))) != NULL
+          && validarSnapshot(&c, salasGravadas, textos, inicio, hashes, indice, pistas, suspeitos, relacoes, conjunto);
+    if (!ok) {
+        munmap(mapa, (size_t) info.st_size);
+        return 0;
+    }
+
+    // Mapa: recriado só se ainda não existir
+    if (totalSalas == 0) {
+        for (uint32_t i = 0; i < c.totalSalas; i++) criarSala(salasGravadas[i].nome);
+        for (uint32_t i = 0; i < c.totalSalas; i++)
+            conectarSalas((int) i, salasGravadas[i].esquerda, salasGravadas[i].direita);
+    }
+    reiniciarSessao(sessao, c.salaAtual);
+    sessao->estatPistas = c.estatPistas;
+
+    // Pool da sessão: cópia em bloco dos vetores
+    PoolPistas* pool = &sessao->pool;
+    if (c.bytesTextos > pool->capacidade) {
+        pool->textos = (char*) realocarOuSair(pool->textos, c.bytesTextos, "pool de pistas");
+        pool->capacidade = c.bytesTextos;
+    }
+    if (c.numTextos > pool->capacidadeIds) {
+        pool->inicio = (size_t*) realocarOuSair(pool->inicio, c.numTextos * sizeof(size_t), "pool de pistas");
+        pool->hashes = (uint64_t*) realocarOuSair(pool->hashes, c.numTextos * sizeof(uint64_t), "pool de pistas");
+        pool->capacidadeIds = c.numTextos;
+    }
+    if (c.tamanhoIndice != pool->tamanhoIndice) {
+        free(pool->indice);
+        pool->indice = NULL;
+        if (c.tamanhoIndice)
+            pool->indice = (uint32_t*) realocarOuSair(NULL, c.tamanhoIndice * sizeof(uint32_t), "índice do pool");
+        pool->tamanhoIndice = c.tamanhoIndice;
+    }
+    if (c.bytesTextos) memcpy(pool->textos, textos, c.bytesTextos);
+    for (uint32_t i = 0; i < c.numTextos; i++) pool->inicio[i] = (size_t) inicio[i];
+    if (c.numTextos) memcpy(pool->hashes, hashes, c.numTextos * sizeof(uint64_t));
+    if (c.tamanhoIndice) memcpy(pool->indice, indice, c.tamanhoIndice * sizeof(uint32_t));
+    pool->usado = c.bytesTextos;
+    pool->quantidade = c.numTextos;
+
+    // Árvore de pistas
+    sessao->arvorePistas = montarArvore(sessao, pistas, c.numPistas);
+
+    // Suspeitos, na ordem do heap, e suas relações
+    TabelaHash* t = &sessao->tabela;
+    if (c.tamanhoTabela != t->tamanho) {
+        free(t->buckets);
+        t->buckets = alocarBuckets(c.tamanhoTabela);
+        t->tamanho = c.tamanhoTabela;
+    }
+    if (c.numSuspeitos > sessao->capacidadeRanking) {
+        sessao->capacidadeRanking = c.numSuspeitos;
+        sessao->ranking = (Suspeito**) realocarOuSair(sessao->ranking,
+                              sessao->capacidadeRanking * sizeof(Suspeito*), "ranking");
+    }
+    const uint32_t* rel = relacoes;
+    for (uint64_t i = 0; i < c.numSuspeitos; i++) {
+        Suspeito* s = (Suspeito*) alocarArena(&sessao->arenaSuspeitos, sizeof(Suspeito));
+        memcpy(s->nome, suspeitos[i].nome, MAX_NOME);
+        s->hash = suspeitos[i].hash;
+        s->id = suspeitos[i].id;
+        s->numPistas = suspeitos[i].numPistas;
+        s->posRanking = i;
+        sessao->ranking[i] = s;
+
+        // a lista é refeita de trás para frente para manter a ordem gravada
+        s->pistas = NULL;
+        for (int j = s->numPistas - 1; j >= 0; j--) {
+            Relacao* r = (Relacao*) alocarArena(&sessao->arenaRelacoes, sizeof(Relacao));
+            r->pista = rel[j];
+            r->prox = s->pistas;
+            s->pistas = r;
+        }
+        rel += s->numPistas;
+
+        size_t idx = s->hash & (t->tamanho - 1);
+        s->prox = t->buckets[idx];
+        t->buckets[idx] = s;
+    }
+    t->quantidade = c.numSuspeitos;
+    sessao->tamanhoRanking = c.numSuspeitos;
+
+    // Conjunto de relações: cópia em bloco
+    ConjuntoRelacoes* cr = &sessao->relacoes;
+    if (c.tamanhoConjunto != cr->tamanho) {
+        free(cr->chaves);
+        cr->chaves = c.tamanhoConjunto ? (uint64_t*) realocarOuSair(NULL, c.tamanhoConjunto * sizeof(uint64_t),
+                                                                   "conjunto de relações") : NULL;
+        cr->tamanho = c.tamanhoConjunto;
+    }
+    if (c.tamanhoConjunto) memcpy(cr->chaves, conjunto, c.tamanhoConjunto * sizeof(uint64_t));
+    cr->quantidade = c.numRelacoes;
+
+    // Índice reverso pista → suspeitos
+    if (c.numRelacoes > 0) reservarIndiceReverso(sessao, (size_t) pool->primeiroId + pool->quantidade - 1);
+    for (uint64_t i = 0; i < c.numSuspeitos; i++) {
+        Suspeito* s = sessao->ranking[i];
+        for (Relacao* r = s->pistas; r != NULL; r = r->prox) {
+            Implicacao* im = (Implicacao*) alocarArena(&sessao->arenaRelacoes, sizeof(Implicacao));
+            im->suspeito = s;
+            im->prox = sessao->suspeitosPorPista[r->pista];
+            sessao->suspeitosPorPista[r->pista] = im;
+        }
+    }
+
+    munmap(mapa, (size_t) info.st_size);
+    return 1;
+}
+
+// Relatório de memória
+
+void relatorioArena(const Arena* a) {
+    printf("%s: %zu nós, %zu bytes usados, %zu bytes reservados em %zu bloco(s)\n",
+           a->nome, a->objetos, a->bytesUsados, a->bytesReservados, a->blocos);
+}
+
+// Mostra quantos nós e bytes cada arena atendeu e quantos mallocs isso custou
+void relatorioArenas(Sessao* sessao) {
+    printf("\n=== Memória (arenas) ===\n");
+    printf("Mapa: %d salas, %zu bytes de nós, %zu bytes de nomes\n", totalSalas,
+           (size_t) totalSalas * sizeof(Sala), usadoNomesSalas);
+    relatorioArena(&arenaRegras);
+    relatorioArena(&sessao->arenaPistas);
+    relatorioArena(&sessao->arenaSuspeitos);
+    relatorioArena(&sessao->arenaRelacoes);
+    printf("Pool de pistas: %u textos distintos, %zu bytes de texto\n",
+           poolRegras.quantidade + sessao->pool.quantidade, poolRegras.usado + sessao->pool.usado);
+    printf("Chamadas a malloc: %zu\n", (size_t) totalMallocs);
+}
+
+// Estatísticas das estruturas
+// Mostra os contadores do caminho quente (se compilados) e medidas calculadas
+// na hora: ocupação e cadeias da hash, relações por suspeito e bytes por
+// estrutura. Serve para ver, sem profiler, se a árvore degenerou ou se as
+// cadeias da tabela cresceram.
+
+void escreverEstatisticas(Sessao* sessao, Saida* out) {
+    escreverTexto(out, "\n=== Estatísticas ===\n");
+
+    // Árvore de pistas
+    EstatPistas* ep = &sessao->estatPistas;
+    escreverFormatado(out, "Árvore de pistas: %zu nós, altura %d\n", sessao->arenaPistas.objetos, alturaPista(sessao->arvorePistas));
+#if ESTATISTICAS
+    escreverFormatado(out, "  inserções: %zu, comparações: %zu (%.1f por inserção)\n", ep->insercoes, ep->comparacoes,
+                      ep->insercoes ? (double) ep->comparacoes / ep->insercoes : 0.0);
+    escreverFormatado(out, "  profundidade: média %.1f, máxima %d, última %d\n",
+                      ep->insercoes ? (double) ep->profundidadeTotal / ep->insercoes : 0.0,
+                      ep->profundidadeMax, ep->ultimaProfundidade);
+#else
+    (void) ep;
+#endif
+
+    // Tabela de suspeitos: ocupação e cadeias
+    const TabelaHash* t = &sessao->tabela;
+    size_t ocupados = 0, maiorCadeia = 0;
+    for (size_t i = 0; i < totalBuckets(t); i++) {
+        size_t cadeia = 0;
+        for (Suspeito* s = bucketCombinada(t, i); s != NULL; s = s->prox) cadeia++;
+        if (cadeia > 0) ocupados++;
+        if (cadeia > maiorCadeia) maiorCadeia = cadeia;
+    }
+    escreverFormatado(out, "Tabela de suspeitos: %zu suspeitos em %zu buckets%s, carga %.2f\n", t->quantidade, t->tamanho,
+                      t->antiga ? " (rehash em andamento)" : "", t->tamanho ? (double) t->quantidade / t->tamanho : 0.0);
+    escreverFormatado(out, "  buckets ocupados: %zu (%.1f%%), cadeia média %.2f, máxima %zu\n", ocupados,
+                      totalBuckets(t) ? 100.0 * ocupados / totalBuckets(t) : 0.0,
+                      ocupados ? (double) t->quantidade / ocupados : 0.0, maiorCadeia);
+#if ESTATISTICAS
+    escreverFormatado(out, "  buscas: %zu, suspeitos comparados por busca: %.2f\n", t->buscas,
+                      t->buscas ? (double) t->nosVisitados / t->buscas : 0.0);
+#endif
+
+    // Relações por suspeito
+    int minRel = 0, maxRel = 0;
+    size_t totalRel = 0;
+    for (size_t i = 0; i < sessao->tamanhoRanking; i++) {
+        int n = sessao->ranking[i]->numPistas;
+        if (i == 0 || n < minRel) minRel = n;
+        if (n > maxRel) maxRel = n;
+        totalRel += n;
+    }
+    escreverFormatado(out, "Relações por suspeito: mínimo %d, média %.2f, máximo %d\n", minRel,
+                      sessao->tamanhoRanking ? (double) totalRel / sessao->tamanhoRanking : 0.0, maxRel);
+
+    // Bytes reservados por estrutura
+    escreverTexto(out, "Memória por estrutura (bytes):\n");
+    escreverFormatado(out, "  salas: %zu\n", (size_t) capacidadeSalas * sizeof(Sala) + capacidadeNomesSalas
+                      + (inicioPortas ? ((size_t) totalSalas + 1 + totalPortas) * sizeof(int) : 0));
+    escreverFormatado(out, "  regras: %zu\n", arenaRegras.bytesReservados + (size_t) totalSalas * sizeof(RegraSala*));
+    escreverFormatado(out, "  árvore de pistas: %zu\n", sessao->arenaPistas.bytesReservados
+                      + sessao->palavrasNaArvore * sizeof(uint64_t));
+    escreverFormatado(out, "  suspeitos: %zu\n", sessao->arenaSuspeitos.bytesReservados);
+    escreverFormatado(out, "  relações: %zu\n", sessao->arenaRelacoes.bytesReservados
+                      + sessao->relacoes.tamanho * sizeof(uint64_t)
+                      + sessao->capacidadePorPista * sizeof(Implicacao*));
+    escreverFormatado(out, "  buckets da hash: %zu\n", totalBuckets(t) * sizeof(Suspeito*));
+    escreverFormatado(out, "  ranking: %zu\n", sessao->capacidadeRanking * sizeof(Suspeito*));
+    const PoolPistas* pools[] = { &poolRegras, &sessao->pool };
+    size_t bytesPool = 0;
+    for (int i = 0; i < 2; i++)
+        bytesPool += pools[i]->capacidade + pools[i]->capacidadeIds * (sizeof(size_t) + sizeof(uint64_t))
+                   + pools[i]->tamanhoIndice * sizeof(uint32_t);
+    escreverFormatado(out, "  textos de pistas: %zu\n", bytesPool);
+}
+
+// Exploração: integração total
+// Um passo da exploração tem duas metades: entrar na sala (regras de coleta)
+// e executar o comando do jogador. O modo interativo e o replay em lote usam
+// as mesmas duas funções, então chegam ao mesmo estado final de pistas e
+// suspeitos para a mesma sequência de comandos. Com saída NULL nada é
+// impresso. O servidor usa as mesmas funções com uma saída em memória por
+// conexão.
+
+// Entra na sala atual e aplica suas regras; retorna 0 se for uma folha (fim)
+int entrarNaSala(Sessao* sessao, Saida* out) {
+    const Sala* atual = &salas[sessao->atual];
+    if (out) {
+        escreverTexto(out, "\nVocê está na: ");
+        escreverTexto(out, nomeSala(sessao->atual));
+        escreverTexto(out, "\n");
+    }
+
+    // Regras de coleta: uma consulta indexada pelo id da sala
+    aplicarRegrasDaSala(sessao);
+
+    // Se não houver nenhuma saída, termina
+    int semSaida = inicioPortas != NULL ? grauSala(sessao->atual) == 0
+                                        : atual->esquerda == SALA_NENHUMA && atual->direita == SALA_NENHUMA;
+    if (semSaida) {
+        if (out) escreverTexto(out, "Não há mais saídas. Fim da exploração!\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Vai direto até a sala 'nome', coletando as pistas das salas intermediárias
+// como se o jogador passasse por elas. Se a sala fica abaixo da atual na
+// árvore, a rota desce por ela (rotaPelaArvore, sem busca); senão é a mais
+// curta entre as portas do grafo (busca em largura), o que inclui as portas
+// extras. A sala de destino é tratada pela exploração (entrarNaSala) no
+// passo seguinte. Com 'out' NULL (replay) nada é escrito.
+void navegarAteSala(Sessao* sessao, const char* nome, Saida* out) {
+    int destino = buscarSalaPorNome(nome);
+    if (destino == SALA_NENHUMA) {
+        if (out) escreverFormatado(out, "Sala '%s' não encontrada.\n", nome);
+        return;
+    }
+    int n = rotaPelaArvore(sessao, sessao->atual, destino);
+    if (n == 0) n = rotaEntreSalas(sessao, sessao->atual, destino);
+    if (n == 0) {
+        if (out) escreverFormatado(out, "Não há caminho até %s.\n", nome);
+        return;
+    }
+    const int* caminho = sessao->fila;
+    if (out) {
+        escreverFormatado(out, "🧭 Rota até %s (%d passo(s)): ", nome, n - 1);
+        for (int i = 0; i < n; i++) {
+            if (i) escreverTexto(out, " → ");
+            escreverTexto(out, nomeSala(caminho[i]));
+        }
+        escreverTexto(out, "\n");
+    }
+    for (int i = 1; i + 1 < n; i++) {
+        sessao->atual = caminho[i];
+        aplicarRegrasDaSala(sessao);
+    }
+    sessao->atual = destino;
+}
+
+// Distância na planta (árvore esquerda/direita, em qualquer sentido) entre a
+// sala atual e 'nome', e a sala onde os caminhos das duas a partir do hall se
+// separam; consultas O(1) nas tabelas de prepararRotas
+void escreverDistanciaSala(Sessao* sessao, const char* nome, Saida* out) {
+    int destino = buscarSalaPorNome(nome);
+    if (destino == SALA_NENHUMA) {
+        escreverFormatado(out, "Sala '%s' não encontrada.\n", nome);
+        return;
+    }
+    int distancia = distanciaSalas(sessao->atual, destino);
+    if (distancia < 0) {
+        escreverFormatado(out, "%s não está na planta a partir do hall.\n", nome);
+        return;
+    }
+    escreverFormatado(out, "📏 %s fica a %d sala(s) de %s na planta; os caminhos se separam em %s\n",
+                      nome, distancia, nomeSala(sessao->atual), nomeSala(ancestralComum(sessao->atual, destino)));
+}
+
+// Lista as portas da sala atual, numeradas a partir de 1
+void escreverPortas(Sessao* sessao, Saida* out) {
+    int s = sessao->atual;
+    escreverFormatado(out, "Portas de %s:\n", nomeSala(s));
+    for (int p = inicioPortas[s]; p < inicioPortas[s + 1]; p++)
+        escreverFormatado(out, "  %d) %s\n", p - inicioPortas[s] + 1, nomeSala(destinoPortas[p]));
+}
+
+// Move o jogador pela porta 'escolha' (1 = primeira); retorna 0 se ela não existe
+int passarPelaPorta(Sessao* sessao, int escolha) {
+    int s = sessao->atual;
+    if (escolha < 1 || escolha > grauSala(s)) return 0;
+    sessao->atual = destinoPortas[inicioPortas[s] + escolha - 1];
+    return 1;
+}
+
+// Mostra quantas salas ainda são alcançáveis a partir da atual e quais delas
+// guardam uma pista que ainda não foi coletada
+void escreverSalasAlcancaveis(Sessao* sessao, Saida* out) {
+    int n = salasAlcancaveis(sessao, sessao->atual);
+    escreverTexto(out, "\n=== Salas Alcançáveis ===\n");
+    escreverFormatado(out, "%d sala(s) alcançável(is) a partir de %s\n", n, nomeSala(sessao->atual));
+    int comPista = 0;
+    for (int i = 0; i < n && regrasPorSala != NULL; i++) {
+        RegraSala* r = regrasPorSala[sessao->fila[i]];
+        if (r == NULL || r->pista == ID_PISTA_NENHUMA || pistaNaArvore(sessao, r->pista)) continue;
+        escreverTexto(out, "🔍 ");
+        escreverTexto(out, nomeSala(sessao->fila[i]));
+        escreverTexto(out, "\n");
+        comPista++;
+    }
+    if (comPista == 0) escreverTexto(out, "(Nenhuma pista nova ao alcance)\n");
+}
+
+
+// Argumento de um comando: o que veio na mesma linha (servidor) ou, no jogo
+// interativo ('argumento' NULL), o que o jogador digitar depois do pedido.
+// Retorna 0 se não houver argumento.
+int lerArgumento(const char* argumento, const char* pedido, char* destino) {
+    if (argumento != NULL) {
+        snprintf(destino, MAX_LINHA_BUSCA, "%s", argumento);
+        return destino[0] != '\0';
+    }
+    printf("%s", pedido);
+    return scanf(" %127[^\n]", destino) == 1;
+}
+
+// Executa um comando (e/d/o/n/m/a/p/h/i/f/l/g/r/t/s) escrevendo a resposta em
+// 'out'; retorna 0 se o jogador saiu. Com 'out' NULL (replay) só os
+// movimentos valem: e, d e, com o argumento, o e n. Com 'argumento' não NULL
+// (servidor ou replay), o argumento vem junto do comando e 'g', que grava
+// arquivos no servidor, fica indisponível.
+int executarComando(Sessao* sessao, char opcao, const char* argumento, Saida* out) {
+    const Sala* atual = &salas[sessao->atual];
+    char arg[MAX_LINHA_BUSCA];
+    if (opcao == 'e' || opcao == 'E') {
+        if (atual->esquerda != SALA_NENHUMA) sessao->atual = atual->esquerda;
+        else if (out) escreverTexto(out, "Não há sala à esquerda!\n");
+    }
+    else if (opcao == 'd' || opcao == 'D') {
+        if (atual->direita != SALA_NENHUMA) sessao->atual = atual->direita;
+        else if (out) escreverTexto(out, "Não há sala à direita!\n");
+    }
+    else if ((opcao == 'o' || opcao == 'O') && out == NULL) {
+        if (argumento != NULL) passarPelaPorta(sessao, atoi(argumento));
+    }
+    else if ((opcao == 'n' || opcao == 'N') && out == NULL) {
+        if (argumento != NULL) navegarAteSala(sessao, argumento, NULL);
+    }
+    else if (out == NULL) {
+        return opcao != 's' && opcao != 'S';
+    }
+    else if (opcao == 'p' || opcao == 'P') {
+        escreverTexto(out, "\n=== Pistas Coletadas ===\n");
+        if (sessao->arvorePistas == NULL) escreverTexto(out, "(Nenhuma pista encontrada ainda)\n");
+        else escreverPistas(sessao, sessao->arvorePistas, out);
+    }
+    else if (opcao == 'h' || opcao == 'H') {
+        escreverAssociacoes(sessao, out);
+    }
+    else if (opcao == 'i' || opcao == 'I') {
+        escreverTexto(out, "\n=== Suspeitos Implicados por Pista ===\n");
+        if (sessao->arvorePistas == NULL) escreverTexto(out, "(Nenhuma pista encontrada ainda)\n");
+        else escreverImplicados(sessao, sessao->arvorePistas, out);
+    }
+    else if (opcao == 'f' || opcao == 'F') {
+        if (lerArgumento(argumento, "Procurar (termo* para prefixo): ", arg)) {
+            escreverTexto(out, "\n=== Pistas Encontradas ===\n");
+            buscarPistas(sessao, arg, out);
+        }
+    }
+    else if (opcao == 'l' || opcao == 'L') {
+        int temArg = lerArgumento(argumento, "Listar pistas depois de (- para o início): ", arg);
+        if (temArg || argumento != NULL) {
+            if (!temArg || strcmp(arg, "-") == 0) arg[0] = '\0';
+            escreverTexto(out, "\n=== Pistas ===\n");
+            int haMais;
+            Pista* ultima = escreverPaginaPistas(sessao, sessao->arvorePistas, arg, TAM_PAGINA_PISTAS, out, &haMais);
+            if (out->formato == FORMATO_TEXTO) {
+                if (ultima == NULL) escreverTexto(out, "(Nenhuma pista nesta página)\n");
+                else if (haMais) {
+                    escreverTexto(out, "(continua: 'l' depois de ");
+                    escreverTexto(out, textoPista(&sessao->pool, ultima->pista));
+                    escreverTexto(out, ")\n");
+                }
+            }
+        }
+    }
+    else if ((opcao == 'g' || opcao == 'G') && argumento != NULL) {
+        escreverTexto(out, "Comando indisponível no servidor.\n");
+    }
+    else if (opcao == 'g' || opcao == 'G') {
+        if (lerArgumento(argumento, "Gravar investigação em: ", arg)) {
+            if (gravarSnapshot(sessao, arg)) escreverFormatado(out, "💾 Investigação gravada em %s (retome com --retomar)\n", arg);
+            else escreverFormatado(out, "Não foi possível gravar %s\n", arg);
+        }
+    }
+    else if (opcao == 'o' || opcao == 'O') {
+        if (argumento == NULL || argumento[0] == '\0') {
+            escreverPortas(sessao, out);
+            descarregarSaida(out);     // a lista aparece antes do pedido
+        }
+        if (argumento == NULL || argumento[0] != '\0') {
+            if (!lerArgumento(argumento, "Escolha a porta: ", arg) || !passarPelaPorta(sessao, atoi(arg)))
+                escreverTexto(out, "Porta inválida!\n");
+        }
+    }
+    else if (opcao == 'a' || opcao == 'A') {
+        escreverSalasAlcancaveis(sessao, out);
+    }
+    else if (opcao == 'n' || opcao == 'N') {
+        if (lerArgumento(argumento, "Navegar até a sala: ", arg)) navegarAteSala(sessao, arg, out);
+    }
+    else if (opcao == 'm' || opcao == 'M') {
+        if (lerArgumento(argumento, "Distância até a sala: ", arg)) escreverDistanciaSala(sessao, arg, out);
+    }
+    else if (opcao == 'r' || opcao == 'R') {
+        escreverRanking(sessao, TOP_RANKING, out);
+    }
+    else if (opcao == 't' || opcao == 'T') {
+        escreverEstatisticas(sessao, out);
+    }
+    else if (opcao == 's' || opcao == 'S') {
+        escreverTexto(out, "Saindo da mansão...\n");
+        return 0;
+    }
+    else {
+        escreverTexto(out, "Opção inválida! Use 'e', 'd', 'o', 'n', 'm', 'a', 'p', 'h', 'i', 'f', 'l', 'g', 'r', 't' ou 's'.\n");
+    }
+    return 1;
+}
+
+// A função explorarSalas navega pela árvore de salas lendo comandos do teclado.
+// Ao entrar em determinadas salas, adiciona pista na BST e associa a suspeitos na hash.
+void explorarSalas(Sessao* sessao) {
+    char opcao;
+    while (sessao->atual != SALA_NENHUMA) {
+        Saida* out = saidaPadrao(sessao);
+        int continua = entrarNaSala(sessao, out);
+        descarregarSaida(out);
+        if (!continua) return;
+
+        printf("Deseja ir para (e) esquerda, (d) direita, (o) outras portas, (n) navegar até uma sala, (m) distância até uma sala, (a) salas alcançáveis, (p) ver pistas, (h) ver suspeitos, (i) suspeitos por pista, (f) procurar pista, (l) listar página de pistas, (g) gravar, (r) ranking, (t) estatísticas ou (s) sair? ");
+        if (scanf(" %c", &opcao) != 1) opcao = 's';   // fim da entrada: sai da mansão
+
+        out = saidaPadrao(sessao);
+        continua = executarComando(sessao, opcao, NULL, out);
+        descarregarSaida(out);
+        if (!continua) return;
+    }
+}
+
+// Mostra o estado final da investigação: pistas, associações e suspeito principal
+void revisaoFinal(Sessao* sessao) {
+    printf("\n=== Revisão Final das Pistas (ordem alfabética) ===\n");
+    if (sessao->arvorePistas == NULL) printf("(Nenhuma pista coletada)\n");
+    else listarPistas(sessao, sessao->arvorePistas);
+
+    listarAssociacoes(sessao);
+    suspeitoMaisProvavel(sessao);
+}
+
+// Replay em lote (modo sem terminal)
+// Lê sessões de um arquivo (ou '-' para stdin), uma por linha, cada uma com
+// uma sequência de comandos e/d/o/n/p/h/r/s (espaços são ignorados). Um
+// comando com argumento leva o argumento entre colchetes logo depois da
+// letra: "o[2]" passa pela segunda porta e "n[Jardim de Inverno]" navega até
+// a sala, como no jogo interativo. As sessões
+// são reproduzidas sem imprimir nada, 'repeticoes' vezes, por um grupo de
+// threads: cada thread tem sua própria Sessao e pega lotes de LOTE_REPLAY
+// sessões de um contador atômico. Ao final são mostradas sessões por segundo
+// e latência média por movimento.
+// Uma sessão termina numa folha, com 's' ou quando os comandos acabam.
+
+#define LOTE_REPLAY 64
+
+typedef struct Replay {
+    char** sessoes;
+    size_t quantidade;
+    size_t capacidade;
+} Replay;
+
+// Carrega todas as linhas de comandos na memória (a leitura fica fora da medição)
+int carregarReplay(Replay* r, const char* caminho) {
+    FILE* f = strcmp(caminho, "-") == 0 ? stdin : fopen(caminho, "r");
+    if (!f) return 0;
+    char* linha = NULL;
+    size_t tamLinha = 0;
+    while (getline(&linha, &tamLinha, f) != -1) {
+        if (r->quantidade == r->capacidade) {
+            r->capacidade = r->capacidade ? r->capacidade * 2 : 64;
+            r->sessoes = (char**) realocarOuSair(r->sessoes, r->capacidade * sizeof(char*), "sessões do replay");
+        }
+        linha[strcspn(linha, "\r\n")] = '\0';
+        r->sessoes[r->quantidade] = strdup(linha);
+        if (!r->sessoes[r->quantidade]) { printf("Erro malloc sessão do replay\n"); exit(1); }
+        totalMallocs++;
+        r->quantidade++;
+    }
+    free(linha);
+    if (f != stdin) fclose(f);
+    return 1;
+}
+
+void liberarReplay(Replay* r) {
+    for (size_t i = 0; i < r->quantidade; i++) free(r->sessoes[i]);
+    free(r->sessoes);
+    r->sessoes = NULL;
+    r->quantidade = r->capacidade = 0;
+}
+
+// Reproduz uma sessão a partir da posição atual; retorna o número de movimentos
+size_t reproduzirSessao(Sessao* sessao, const char* comandos) {
+    size_t movimentos = 0;
+    char arg[MAX_LINHA_BUSCA];
+    while (entrarNaSala(sessao, NULL)) {
+        while (*comandos == ' ' || *comandos == '\t') comandos++;
+        if (*comandos == '\0') break;
+        movimentos++;
+        char opcao = *comandos++;
+        const char* argumento = NULL;
+        if (*comandos == '[') {   // argumento até o ']' (ou o fim da linha)
+            size_t tam = strcspn(++comandos, "]");
+            snprintf(arg, sizeof(arg), "%.*s", (int) tam, comandos);
+            argumento = arg;
+            comandos += tam + (comandos[tam] == ']');
+        }
+        if (!executarComando(sessao, opcao, argumento, NULL)) break;
+    }
+    return movimentos;
+}
+
+// Trabalho compartilhado pelas threads do replay
+typedef struct TrabalhoReplay {
+    int inicio;
+    const Replay* replay;
+    size_t total;              // sessões a reproduzir (linhas × repetições)
+    _Atomic size_t proxima;    // próxima sessão ainda não reservada
+    int mostrarEstado;
+    TabelaCompartilhada* compartilhada;   // tabela comum às threads (ou NULL)
+} TrabalhoReplay;
+
+// Estado e contadores de uma thread do replay
+typedef struct Trabalhador {
+    pthread_t thread;
+    TrabalhoReplay* trabalho;
+    Sessao sessao;
+    size_t sessoes;
+    size_t movimentos;
+    double tempo;              // tempo ocupado reproduzindo sessões
+} Trabalhador;
+
+void* executarTrabalhador(void* arg) {
+    Trabalhador* w = (Trabalhador*) arg;
+    TrabalhoReplay* tr = w->trabalho;
+    iniciarSessao(&w->sessao, tr->inicio);
+    if (tr->compartilhada) {
+        w->sessao.compartilhada = tr->compartilhada;
+        w->sessao.participante = entrarNaTabela(tr->compartilhada);
+    }
+
+    for (;;) {
+        size_t ini = atomic_fetch_add(&tr->proxima, LOTE_REPLAY);
+        if (ini >= tr->total) break;
+        size_t fim = ini + LOTE_REPLAY < tr->total ? ini + LOTE_REPLAY : tr->total;
+
+        double t0 = agoraSegundos();
+        for (size_t i = ini; i < fim; i++) {
+            w->movimentos += reproduzirSessao(&w->sessao, tr->replay->sessoes[i % tr->replay->quantidade]);
+            if (tr->mostrarEstado) {
+                printf("\n=== Sessão %zu ===", i + 1);
+                revisaoFinal(&w->sessao);
+            }
+            reiniciarSessao(&w->sessao, tr->inicio);
+        }
+        w->tempo += agoraSegundos() - t0;
+        w->sessoes += fim - ini;
+    }
+    if (tr->compartilhada) sairDaTabela(tr->compartilhada, w->sessao.participante);
+    liberarSessao(&w->sessao);
+    return NULL;
+}
+
+// Executa o replay com 'threads' threads e imprime as métricas. Com
+// 'mostrarEstado' roda numa thread só e imprime a revisão final de cada
+// sessão, na ordem do arquivo (para conferir com o jogo interativo). Com
+// 'compartilhada', todas as sessões registram associações também nela.
+void executarReplay(int inicio, const Replay* r, long repeticoes, int threads, int mostrarEstado,
+                    TabelaCompartilhada* compartilhada) {
+    if (mostrarEstado || threads < 1) threads = 1;
+    if (compartilhada && threads > MAX_PARTICIPANTES - 1) threads = MAX_PARTICIPANTES - 1;
+    TrabalhoReplay tr = { .inicio = inicio, .replay = r, .mostrarEstado = mostrarEstado,
+                          .compartilhada = compartilhada };
+    tr.total = r->quantidade * (size_t)(repeticoes > 0 ? repeticoes : 0);
+    atomic_init(&tr.proxima, 0);
+
+    Trabalhador* ws = (Trabalhador*) calloc(threads, sizeof(Trabalhador));
+    if (!ws) { printf("Erro malloc threads do replay\n"); exit(1); }
+    totalMallocs++;
+
+    double t0 = agoraSegundos();
+    for (int i = 0; i < threads; i++) {
+        ws[i].trabalho = &tr;
+        if (threads == 1) executarTrabalhador(&ws[i]);
+        else if (pthread_create(&ws[i].thread, NULL, executarTrabalhador, &ws[i]) != 0) {
+            printf("Erro ao criar thread do replay\n");
+            exit(1);
+        }
+    }
+    if (threads > 1)
+        for (int i = 0; i < threads; i++) pthread_join(ws[i].thread, NULL);
+    double parede = agoraSegundos() - t0;
+
+    size_t sessoes = 0, movimentos = 0;
+    double ocupado = 0;
+    for (int i = 0; i < threads; i++) {
+        sessoes += ws[i].sessoes;
+        movimentos += ws[i].movimentos;
+        ocupado += ws[i].tempo;
+    }
+    free(ws);
+
+    printf("\n=== Replay em lote ===\n");
+    printf("Threads: %d\n", threads);
+    printf("Sessões: %zu\n", sessoes);
+    printf("Movimentos: %zu\n", movimentos);
+    printf("Tempo: %.6f s\n", parede);
+    printf("Sessões por segundo: %.0f\n", parede > 0 ? sessoes / parede : 0.0);
+    printf("Latência média por movimento: %.1f ns\n", movimentos ? ocupado * 1e9 / movimentos : 0.0);
+}
+
+// Servidor de jogadores
+// Com --servidor, um processo atende muitos jogadores ao mesmo tempo por um
+// socket local: uma porta TCP em 127.0.0.1 ou, se o endereço tiver '/', um
+// socket Unix. Tudo roda num laço de eventos (epoll) numa thread só. Cada
+// conexão tem sua própria Sessao; mapa e regras são montados antes e só lidos
+// depois, então todas as conexões os compartilham sem cópia nem trava.
+// Nenhuma chamada bloqueia: os sockets são não bloqueantes, cada linha
+// recebida é executada pelo mesmo executarComando do jogo interativo e a
+// resposta vai para a Saida em memória da sessão, enviada quando o socket
+// aceitar. As linhas de uma leitura (no máximo TAM_LEITURA_SERVIDOR bytes)
+// são executadas uma por vez: se a resposta de uma não sai inteira, o resto
+// da leitura fica guardado na conexão, que deixa de ser lida (espera só
+// EPOLLOUT) e retoma as linhas quando a resposta termina de sair. Assim a
+// resposta pendente é sempre de um comando só, e um cliente lento não faz o
+// servidor acumular memória nem atrasa os outros.
+// Protocolo: uma linha por comando, a letra seguida do argumento ("f faca*",
+// "n Cozinha", "o 2", "l -"); cada resposta termina com PROMPT_SERVIDOR. Ao
+// chegar numa sala sem saída a investigação termina com o ranking e outra
+// começa no hall, na mesma conexão.
+
+#define PROMPT_SERVIDOR "\n> "
+#define MAX_LINHA_SERVIDOR 256
+#define MAX_EVENTOS_SERVIDOR 256
+#define TAM_LEITURA_SERVIDOR 4096
+
+typedef struct Conexao {
+    int fd;
+    Sessao sessao;             // sessao.saida guarda a resposta pendente
+    size_t enviado;            // bytes da resposta já enviados
+    int esperandoEnvio;        // registrada para EPOLLOUT em vez de EPOLLIN
+    int encerrar;              // fecha depois de enviar a resposta
+    int descartando;           // linha longa demais: ignora até o '\n'
+    size_t tamLinha;
+    char linha[MAX_LINHA_SERVIDOR];
+    size_t lido;               // bytes de 'entrada' já consumidos
+    size_t recebido;
+    char entrada[TAM_LEITURA_SERVIDOR];   // última leitura, à espera das respostas
+    struct Conexao* ant;
+    struct Conexao* prox;
+} Conexao;
+
+typedef struct Servidor {
+    int fd;
+    int epoll;
+    int inicio;
+    int aceitando;             // 0 enquanto faltam descritores (EMFILE)
+    Conexao* conexoes;         // lista das conexões abertas
+    size_t atendidas;
+    size_t comandos;
+    double tempoComandos;
+    double maiorLatencia;
+} Servidor;
+
+volatile sig_atomic_t servidorAtivo = 1;
+
+void pararServidor(int sinal) {
+    (void) sinal;
+    servidorAtivo = 0;
+}
+
+// Abre o socket de escuta: porta TCP em 127.0.0.1 ou caminho de socket Unix
+int abrirSocketServidor(const char* endereco) {
+    int fd;
+    if (strchr(endereco, '/') != NULL) {
+        struct sockaddr_un un = { .sun_family = AF_UNIX };
+        if (strlen(endereco) >= sizeof(un.sun_path)) return -1;
+        strcpy(un.sun_path, endereco);
+        unlink(endereco);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (bind(fd, (struct sockaddr*) &un, sizeof(un)) < 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_in in = { .sin_family = AF_INET };
+        in.sin_port = htons((uint16_t) atoi(endereco));
+        in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        int um = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+        if (bind(fd, (struct sockaddr*) &in, sizeof(in)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void escutarNovasConexoes(Servidor* srv, int escutar) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(srv->epoll, escutar ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, srv->fd, &ev);
+    srv->aceitando = escutar;
+}
+
+void fecharConexao(Servidor* srv, Conexao* c) {
+    close(c->fd);              // o close também tira o fd do epoll
+    if (c->ant) c->ant->prox = c->prox;
+    else srv->conexoes = c->prox;
+    if (c->prox) c->prox->ant = c->ant;
+    liberarSessao(&c->sessao);
+    free(c);
+    if (!srv->aceitando) escutarNovasConexoes(srv, 1);   // liberou um descritor
+}
+
+// Envia o que couber da resposta pendente e escolhe o evento que a conexão
+// espera: EPOLLOUT se sobrou resposta, EPOLLIN se não. Retorna 0 para fechar.
+int enviarResposta(Servidor* srv, Conexao* c) {
+    Saida* s = &c->sessao.saida;
+    while (c->enviado < s->usado) {
+        ssize_t n = send(c->fd, s->buf + c->enviado, s->usado - c->enviado, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return 0;
+        }
+        c->enviado += (size_t) n;
+    }
+    int pendente = c->enviado < s->usado;
+    if (!pendente) {
+        s->usado = 0;
+        c->enviado = 0;
+        if (c->encerrar) return 0;
+    }
+    if (pendente != c->esperandoEnvio) {
+        struct epoll_event ev = { .events = pendente ? EPOLLOUT : EPOLLIN, .data.ptr = c };
+        if (epoll_ctl(srv->epoll, EPOLL_CTL_MOD, c->fd, &ev) < 0) return 0;
+        c->esperandoEnvio = pendente;
+    }
+    return 1;
+}
+
+// Executa uma linha de comando da conexão e entra na sala resultante,
+// como um passo de explorarSalas
+void processarLinha(Servidor* srv, Conexao* c, char* linha) {
+    Sessao* sessao = &c->sessao;
+    Saida* out = &sessao->saida;
+    while (*linha == ' ' || *linha == '\t') linha++;
+    if (*linha == '\0') {
+        escreverTexto(out, PROMPT_SERVIDOR);
+        return;
+    }
+    char opcao = *linha++;
+    while (*linha == ' ' || *linha == '\t') linha++;
+
+    double t0 = agoraSegundos();
+    if (!executarComando(sessao, opcao, linha, out)) {
+        c->encerrar = 1;
+    } else if (!entrarNaSala(sessao, out)) {
+        escreverRanking(sessao, TOP_RANKING, out);
+        escreverTexto(out, "\n=== Nova investigação ===\n");
+        reiniciarSessao(sessao, srv->inicio);
+        entrarNaSala(sessao, out);
+    }
+    double latencia = agoraSegundos() - t0;
+    srv->comandos++;
+    srv->tempoComandos += latencia;
+    if (latencia > srv->maiorLatencia) srv->maiorLatencia = latencia;
+
+    if (!c->encerrar) escreverTexto(out, PROMPT_SERVIDOR);
+}
+
+// Executa as linhas completas já recebidas, uma por vez, enviando cada
+// resposta; se uma não sai inteira, para e deixa o resto da entrada para
+// quando ela sair. Retorna 0 para fechar.
+int processarEntrada(Servidor* srv, Conexao* c) {
+    while (c->lido < c->recebido && !c->encerrar) {
+        char ch = c->entrada[c->lido++];
+        int respondeu = 0;
+        if (ch == '\n') {
+            if (!c->descartando) {
+                if (c->tamLinha > 0 && c->linha[c->tamLinha - 1] == '\r') c->tamLinha--;
+                c->linha[c->tamLinha] = '\0';
+                processarLinha(srv, c, c->linha);
+                respondeu = 1;
+            }
+            c->tamLinha = 0;
+            c->descartando = 0;
+        } else if (!c->descartando) {
+            if (c->tamLinha + 1 < MAX_LINHA_SERVIDOR) c->linha[c->tamLinha++] = ch;
+            else {
+                c->descartando = 1;
+                c->tamLinha = 0;
+                escreverTexto(&c->sessao.saida, "Linha longa demais!\n" PROMPT_SERVIDOR);
+                respondeu = 1;
+            }
+        }
+        if (respondeu) {
+            if (!enviarResposta(srv, c)) return 0;
+            if (c->esperandoEnvio) return 1;
+        }
+    }
+    c->lido = c->recebido = 0;
+    return enviarResposta(srv, c);
+}
+
+// Lê um bloco da conexão e executa as linhas completas; retorna 0 para fechar
+int lerConexao(Servidor* srv, Conexao* c) {
+    ssize_t n = recv(c->fd, c->entrada, sizeof(c->entrada), 0);
+    if (n == 0) return 0;
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    c->lido = 0;
+    c->recebido = (size_t) n;
+    return processarEntrada(srv, c);
+}
+
+// Aceita todas as conexões pendentes; cada uma começa no hall
+void aceitarConexoes(Servidor* srv) {
+    for (;;) {
+        int fd = accept4(srv->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EMFILE || errno == ENFILE) escutarNovasConexoes(srv, 0);
+            return;
+        }
+        int um = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));   // em socket Unix só falha
+
+        Conexao* c = (Conexao*) calloc(1, sizeof(Conexao));
+        if (!c) { printf("Erro malloc conexão\n"); exit(1); }
+        totalMallocs++;
+        c->fd = fd;
+        iniciarSessao(&c->sessao, srv->inicio);
+        iniciarSaidaEmMemoria(&c->sessao.saida, formatoSaida);
+        c->prox = srv->conexoes;
+        if (srv->conexoes) srv->conexoes->ant = c;
+        srv->conexoes = c;
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (epoll_ctl(srv->epoll, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            fecharConexao(srv, c);
+            continue;
+        }
+        srv->atendidas++;
+
+        Saida* out = &c->sessao.saida;
+        escreverTexto(out, "=== Detective Quest: Nível Mestre ===\n");
+        escreverTexto(out, "Explore, colete pistas e relacione suspeitos.\n");
+        entrarNaSala(&c->sessao, out);
+        escreverTexto(out, PROMPT_SERVIDOR);
+        if (!enviarResposta(srv, c)) fecharConexao(srv, c);
+    }
+}
+
+// Atende jogadores em 'endereco' até SIGINT/SIGTERM e imprime as métricas;
+// retorna 0 se não foi possível abrir o socket
+int executarServidor(int inicio, const char* endereco) {
+    Servidor srv = { .inicio = inicio };
+    srv.fd = abrirSocketServidor(endereco);
+    if (srv.fd < 0) return 0;
+    srv.epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (srv.epoll < 0) {
+        close(srv.fd);
+        return 0;
+    }
+    escutarNovasConexoes(&srv, 1);
+
+    // Cada jogador é um descritor: sobe o limite até o máximo permitido
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    // Sem SA_RESTART: o sinal interrompe o epoll_wait e o laço termina
+    struct sigaction sa = { .sa_handler = pararServidor };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Servidor ouvindo em %s (Ctrl+C encerra)\n", endereco);
+    fflush(stdout);
+
+    struct epoll_event eventos[MAX_EVENTOS_SERVIDOR];
+    double t0 = agoraSegundos();
+    while (servidorAtivo) {
+        int n = epoll_wait(srv.epoll, eventos, MAX_EVENTOS_SERVIDOR, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            Conexao* c = (Conexao*) eventos[i].data.ptr;
+            if (c == NULL) {
+                aceitarConexoes(&srv);
+                continue;
+            }
+            int ok;
+            if (eventos[i].events & EPOLLERR) ok = 0;
+            else if (c->esperandoEnvio) {
+                ok = enviarResposta(&srv, c);
+                if (ok && !c->esperandoEnvio) ok = processarEntrada(&srv, c);   // retoma as linhas guardadas
+            }
+            else ok = lerConexao(&srv, c);    // EPOLLIN ou EPOLLHUP: o recv acusa o fim
+            if (!ok) fecharConexao(&srv, c);
+        }
+    }
+    double parede = agoraSegundos() - t0;
+
+    while (srv.conexoes) fecharConexao(&srv, srv.conexoes);
+    close(srv.epoll);
+    close(srv.fd);
+    if (strchr(endereco, '/') != NULL) unlink(endereco);
+
+    printf("\n=== Servidor ===\n");
+    printf("Conexões atendidas: %zu\n", srv.atendidas);
+    printf("Comandos: %zu\n", srv.comandos);
+    printf("Tempo: %.3f s\n", parede);
+    printf("Comandos por segundo: %.0f\n", parede > 0 ? srv.comandos / parede : 0.0);
+    printf("Latência média por comando: %.1f ns\n", srv.comandos ? srv.tempoComandos * 1e9 / srv.comandos : 0.0);
+    printf("Latência máxima por comando: %.1f ns\n", srv.maiorLatencia * 1e9);
+    return 1;
+}
+
+// main: monta tudo e executa
+// (omitida quando este arquivo é incluído por benchmark_mestre.c)
+#ifndef NIVEL_MESTRE_SEM_MAIN
+int main(int argc, char* argv[]) {
+    // Opções de linha de comando:
+    //   --mapa arquivo        mapa da mansão (padrão: mansao.txt, compilada em mansao_tabelas.h)
+    //   --regras arquivo      regras de coleta (padrão: as de mansao.txt)
+    //   --replay arquivo|-    replay em lote, sem terminal
+    //   --repeticoes N        quantas vezes reproduzir o arquivo de replay
+    //   --threads N           threads do replay (padrão: núcleos disponíveis)
+    //   --mostrar-estado      imprime a revisão final de cada sessão do replay
+    //   --formato texto|tsv   formato das listagens de pistas e suspeitos
+    //   --exportar arquivo    grava pistas e associações finais no arquivo
+    //   --retomar arquivo     continua a investigação de um snapshot (comando 'g')
+    //   --importar-pistas arquivo  carrega pistas em lote (uma por linha) na sessão
+    //   --importar-associacoes arquivo|-  carrega pares suspeito,pista (CSV ou TSV) na sessão
+    //   --compartilhar        o replay junta as associações de todas as threads numa tabela só
+    //   --servidor porta|caminho  atende jogadores por TCP (127.0.0.1) ou socket Unix
+    const char* arquivoMapa = NULL;
+    const char* arquivoRegras = NULL;
+    const char* arquivoReplay = NULL;
+    long repeticoes = 1;
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int mostrarEstado = 0;
+    const char* arquivoExportar = NULL;
+    const char* arquivoRetomar = NULL;
+    const char* arquivoPistas = NULL;
+    const char* arquivoAssociacoes = NULL;
+    int compartilhar = 0;
+    const char* enderecoServidor = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mapa") == 0 && i + 1 < argc) arquivoMapa = argv[++i];
+        else if (strcmp(argv[i], "--regras") == 0 && i + 1 < argc) arquivoRegras = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) arquivoReplay = argv[++i];
+        else if (strcmp(argv[i], "--repeticoes") == 0 && i + 1 < argc) repeticoes = atol(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mostrar-estado") == 0) mostrarEstado = 1;
+        else if (strcmp(argv[i], "--exportar") == 0 && i + 1 < argc) arquivoExportar = argv[++i];
+        else if (strcmp(argv[i], "--retomar") == 0 && i + 1 < argc) arquivoRetomar = argv[++i];
+        else if (strcmp(argv[i], "--importar-pistas") == 0 && i + 1 < argc) arquivoPistas = argv[++i];
+        else if (strcmp(argv[i], "--importar-associacoes") == 0 && i + 1 < argc) arquivoAssociacoes = argv[++i];
+        else if (strcmp(argv[i], "--compartilhar") == 0) compartilhar = 1;
+        else if (strcmp(argv[i], "--servidor") == 0 && i + 1 < argc) enderecoServidor = argv[++i];
+        else if (strcmp(argv[i], "--formato") == 0 && i + 1 < argc)
+            formatoSaida = strcmp(argv[++i], "tsv") == 0 ? FORMATO_TSV : FORMATO_TEXTO;
+    }
+
+    // Mapa da mansão: sem --mapa, as tabelas geradas de mansao.txt (já
+    // renumeradas e com rotas prontas); com --mapa, montado do arquivo. A
+    // primeira sala é o hall; depois da ordenação em largura ele é a sala 0.
+    if (arquivoMapa == NULL) {
+        usarTabelasGeradas(arquivoRegras == NULL);
+    } else if (!carregarMapaDeArquivo(arquivoMapa)) {
+        printf("Não foi possível carregar o mapa %s\n", arquivoMapa);
+        return 1;
+    } else {
+        ordenarSalasEmLargura(0);
+        montarGrafoSalas();
+        prepararRotas(0);
+    }
+    int hall = 0;
+
+    // Regras de coleta: geradas junto com o mapa, de arquivo ou, num mapa de
+    // arquivo, as padrão aplicadas pelo nome das salas
+    if (!regrasGeradas) {
+        iniciarPool(&poolRegras, NULL);
+        if (arquivoRegras == NULL) carregarRegrasPadrao();
+        else if (!carregarRegrasDeArquivo(arquivoRegras)) {
+            printf("Não foi possível abrir o arquivo de regras %s\n", arquivoRegras);
+            return 1;
+        }
+    }
+
+    // Sessão do jogo interativo: pistas e suspeitos começam vazios
+    Sessao sessao;
+    iniciarSessao(&sessao, hall);
+    if (arquivoRetomar != NULL && !carregarSnapshot(&sessao, arquivoRetomar)) {
+        printf("Não foi possível retomar o snapshot %s (arquivo inválido ou de outro mapa/regras)\n", arquivoRetomar);
+        return 1;
+    }
+    if (arquivoPistas != NULL) {
+        double t0 = agoraSegundos();
+        long novas = importarPistasDeArquivo(&sessao, arquivoPistas);
+        if (novas < 0) {
+            printf("Não foi possível abrir o arquivo de pistas %s\n", arquivoPistas);
+            return 1;
+        }
+        printf("Pistas importadas de %s: %ld novas em %.3f s\n", arquivoPistas, novas, agoraSegundos() - t0);
+    }
+    if (arquivoAssociacoes != NULL) {
+        EstatImportacao est;
+        if (!importarAssociacoes(&sessao, arquivoAssociacoes, &est)) {
+            printf("Não foi possível abrir o arquivo de associações %s\n", arquivoAssociacoes);
+            return 1;
+        }
+        printf("Associações importadas de %s: %zu linhas (%zu inválidas), %zu relações novas em %.3f s\n",
+               arquivoAssociacoes, est.linhas, est.invalidas, est.novas, est.segundos);
+        printf("  %.0f linhas/s, %.1f MB/s\n", est.segundos > 0 ? est.linhas / est.segundos : 0.0,
+               est.segundos > 0 ? est.bytes / est.segundos / 1e6 : 0.0);
+    }
+
+    if (enderecoServidor != NULL) {
+        // Servidor: cada conexão tem sua própria sessão
+        if (!executarServidor(hall, enderecoServidor)) {
+            printf("Não foi possível abrir o servidor em %s\n", enderecoServidor);
+            return 1;
+        }
+    } else if (arquivoReplay != NULL) {
+        // Replay em lote: sem interação, só métricas
+        Replay replay = { 0 };
+        if (!carregarReplay(&replay, arquivoReplay)) {
+            printf("Não foi possível abrir o arquivo de replay %s\n", arquivoReplay);
+            return 1;
+        }
+        TabelaCompartilhada tabela;
+        if (compartilhar) iniciarTabelaCompartilhada(&tabela);
+        executarReplay(hall, &replay, repeticoes, threads, mostrarEstado, compartilhar ? &tabela : NULL);
+        if (compartilhar) {
+            Saida* out = saidaPadrao(&sessao);
+            int participante = entrarNaTabela(&tabela);
+            escreverTabelaCompartilhada(&tabela, participante, out);
+            sairDaTabela(&tabela, participante);
+            descarregarSaida(out);
+            liberarTabelaCompartilhada(&tabela);
+        }
+        liberarReplay(&replay);
+    } else {
+        // Introdução
+        printf("=== Detective Quest: Nível Mestre ===\n");
+        printf("Explore, colete pistas e relacione suspeitos.\n");
+
+        // Exploração (coleta de pistas e associações)
+        explorarSalas(&sessao);
+
+        // Revisão final
+        revisaoFinal(&sessao);
+        Saida* out = saidaPadrao(&sessao);
+        escreverEstatisticas(&sessao, out);
+        descarregarSaida(out);
+
+        if (arquivoExportar != NULL && !exportarSessao(&sessao, arquivoExportar))
+            printf("Não foi possível gravar %s\n", arquivoExportar);
+    }
 
-    listarAssociacoes();
-    suspeitoMaisProvavel();
+    relatorioArenas(&sessao);
 
-    // Libera memória
-    liberarArvore(hall);
-    liberarPistas(arvorePistas);
-    liberarHash();
+    // Libera memória: cada estrutura sai inteira com sua arena
+    liberarSessao(&sessao);
+    liberarRegras();
+    liberarSalas();
 
     printf("\nMemória liberada. Caso encerrado! 🕵️‍♀️\n");
     return 0;
 }
+#endif